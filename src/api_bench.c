@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "chessapi.h"
+
+// measures positions per second through the batched entry points of libchess.so
+
+#define MAX_POSITIONS 100000
+#define BATCH_SIZE 1024
+
+long now_ms() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+void report(char* name, int positions, long elapsed) {
+    printf("%-24s %6ld ms, %.2f million positions/s\n", name, elapsed, positions / 1000.0 / (elapsed + 1));
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        printf("usage: %s <fen file>\n", argv[0]);
+        return 1;
+    }
+    FILE* file = fopen(argv[1], "r");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    char** fens = (char**) malloc(sizeof(char*) * MAX_POSITIONS);
+    char line[1024];
+    int n = 0;
+    while (n < MAX_POSITIONS && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        fens[n ++] = strdup(line);
+    }
+    fclose(file);
+
+    packedPosition* positions = (packedPosition*) malloc(sizeof(packedPosition) * n);
+    packedPosition* after = (packedPosition*) malloc(sizeof(packedPosition) * n);
+    unsigned short* moves = (unsigned short*) malloc(sizeof(unsigned short) * CHESS_MAX_MOVES * BATCH_SIZE);
+    unsigned short* firstMoves = (unsigned short*) malloc(sizeof(unsigned short) * n);
+    int* counts = (int*) malloc(sizeof(int) * n);
+    uint64_t* nodes = (uint64_t*) malloc(sizeof(uint64_t) * n);
+
+    long start = now_ms();
+    int invalid = chess_pack_fens((const char* const*) fens, n, positions, NULL);
+    report("pack fens", n, now_ms() - start);
+
+    start = now_ms();
+    uint64_t total = 0;
+    for (int i = 0; i < n; i += BATCH_SIZE) {
+        int size = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+        chess_legal_moves_fen((const char* const*) fens + i, size, moves, counts + i);
+        for (int j = 0; j < size; j ++) {
+            total += counts[i + j] > 0 ? counts[i + j] : 0;
+        }
+    }
+    report("legal moves of fens", n, now_ms() - start);
+
+    start = now_ms();
+    for (int i = 0; i < n; i += BATCH_SIZE) {
+        int size = n - i < BATCH_SIZE ? n - i : BATCH_SIZE;
+        chess_legal_moves_packed(positions + i, size, moves, counts + i);
+        for (int j = 0; j < size; j ++) {
+            firstMoves[i + j] = counts[i + j] > 0 ? moves[j * CHESS_MAX_MOVES] : 0;
+        }
+    }
+    report("legal moves of packed", n, now_ms() - start);
+
+    // the same work with one position per call
+    start = now_ms();
+    for (int i = 0; i < n; i ++) {
+        chess_legal_moves_packed(positions + i, 1, moves, counts + i);
+    }
+    report("one position per call", n, now_ms() - start);
+
+    start = now_ms();
+    chess_count_moves_packed(positions, n, counts);
+    report("count moves of packed", n, now_ms() - start);
+
+    start = now_ms();
+    int failed = chess_apply_move_batch(positions, firstMoves, n, after);
+    report("apply first moves", n, now_ms() - start);
+
+    start = now_ms();
+    chess_perft_packed(positions, n, 2, nodes);
+    long elapsed = now_ms() - start;
+    uint64_t leaves = 0;
+    for (int i = 0; i < n; i ++) {
+        leaves += nodes[i];
+    }
+    report("perft 2", n, elapsed);
+
+    printf("%d positions, %d invalid, %llu moves, %d without a move, %llu perft 2 nodes\n", n, invalid, (unsigned long long) total, failed,
+        (unsigned long long) leaves);
+    for (int i = 0; i < n; i ++) {
+        free(fens[i]);
+    }
+    free(fens);
+    free(positions);
+    free(after);
+    free(moves);
+    free(firstMoves);
+    free(counts);
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bitscan.h"
+#include "chess.h"
+#include "search.h"
+#include "batch.h"
+
+// one bitboard for each position of a batch; the compiler maps operations on it to AVX-512,
+// AVX2 or NEON instructions when they are enabled and to scalar code otherwise
+typedef uint64_t lanes __attribute__((vector_size(8 * BATCH_LANES)));
+
+#define NOT_A 0xfefefefefefefefeULL
+#define NOT_AB 0xfcfcfcfcfcfcfcfcULL
+#define NOT_H 0x7f7f7f7f7f7f7f7fULL
+#define NOT_GH 0x3f3f3f3f3f3f3f3fULL
+#define RANK_3 0x0000000000ff0000ULL
+#define RANK_8 0xff00000000000000ULL
+
+// shift and mask of destination squares of each direction, Nort to NoWe
+int directionShifts[8] = {8, 9, 1, -7, -8, -9, -1, 7};
+uint64_t directionMasks[8] = {~0ULL, NOT_A, NOT_A, NOT_A, ~0ULL, NOT_H, NOT_H, NOT_H};
+
+// shift and mask of destination squares of each knight jump
+int knightShifts[8] = {17, 10, -6, -15, 15, 6, -10, -17};
+uint64_t knightMasks[8] = {NOT_A, NOT_AB, NOT_AB, NOT_A, NOT_H, NOT_GH, NOT_GH, NOT_H};
+
+static inline lanes shift_lanes(lanes bitboards, int shift) {
+    return shift > 0 ? bitboards << shift : bitboards >> -shift;
+}
+
+// attacks of the sliders in gen in direction dir through empty squares, by kogge-stone fill
+static inline lanes fill_attacks(lanes gen, lanes empty, int dir) {
+    int shift = directionShifts[dir];
+    uint64_t mask = directionMasks[dir];
+    empty &= mask;
+    gen |= empty & shift_lanes(gen, shift);
+    empty &= shift_lanes(empty, shift);
+    gen |= empty & shift_lanes(gen, 2 * shift);
+    empty &= shift_lanes(empty, 2 * shift);
+    gen |= empty & shift_lanes(gen, 4 * shift);
+    return shift_lanes(gen, shift) & mask;
+}
+
+static inline void add_counts(int* counts, lanes bitboards, int weight) {
+    for (int lane = 0; lane < BATCH_LANES; lane ++) {
+        counts[lane] += weight * popCount(bitboards[lane]);
+    }
+}
+
+// generate attack maps and count legal moves of up to BATCH_LANES boards at once;
+// boards of black to move are flipped so that every lane moves north
+void generate_batch(chessboard* boards, int numPositions, moveBatch* batch) {
+    lanes own[6]; // pawns, knights, bishops, rooks, queens and king of side to move
+    lanes their[6];
+    for (int type = 0; type < 6; type ++) {
+        for (int lane = 0; lane < BATCH_LANES; lane ++) {
+            own[type][lane] = 0;
+            their[type][lane] = 0;
+            if (lane < numPositions) {
+                chessboard* board = &boards[lane];
+                uint64_t ownPieces = board->pieces[2 * type + (board->turn == White)];
+                uint64_t theirPieces = board->pieces[2 * type + (board->turn == Black)];
+                own[type][lane] = board->turn == White ? ownPieces : __builtin_bswap64(ownPieces);
+                their[type][lane] = board->turn == White ? theirPieces : __builtin_bswap64(theirPieces);
+            }
+        }
+    }
+    lanes ownPieces = own[0] | own[1] | own[2] | own[3] | own[4] | own[5];
+    lanes theirPieces = their[0] | their[1] | their[2] | their[3] | their[4] | their[5];
+    lanes occupied = ownPieces | theirPieces;
+    lanes empty = ~occupied;
+    lanes king = own[5];
+    lanes ownDiagonal = own[2] | own[4];
+    lanes ownStraight = own[3] | own[4];
+    lanes theirDiagonal = their[2] | their[4];
+    lanes theirStraight = their[3] | their[4];
+
+    // opponent attacks through the king, which moves south
+    lanes attacked = ((their[0] >> 7) & NOT_A) | ((their[0] >> 9) & NOT_H);
+    lanes attacks = ((own[0] << 9) & NOT_A) | ((own[0] << 7) & NOT_H);
+    lanes checkers = (((king << 9) & NOT_A) | ((king << 7) & NOT_H)) & their[0];
+    for (int i = 0; i < 8; i ++) {
+        attacked |= shift_lanes(their[1], knightShifts[i]) & knightMasks[i];
+        attacked |= shift_lanes(their[5], directionShifts[i]) & directionMasks[i];
+        attacks |= shift_lanes(own[1], knightShifts[i]) & knightMasks[i];
+        attacks |= shift_lanes(king, directionShifts[i]) & directionMasks[i];
+        checkers |= shift_lanes(king, knightShifts[i]) & knightMasks[i] & their[1];
+    }
+    lanes theirRays[8];
+    for (int dir = 0; dir < 8; dir ++) {
+        theirRays[dir] = fill_attacks(dir & 1 ? theirDiagonal : theirStraight, empty | king, dir);
+        attacked |= theirRays[dir];
+        attacks |= fill_attacks(dir & 1 ? ownDiagonal : ownStraight, empty, dir);
+    }
+
+    // a ray from the king meets the opposite ray of a slider on the squares between a checker
+    // and the king, or on a pinned piece
+    lanes between = {0};
+    lanes pinned = {0};
+    lanes pinnedLines[4] = {{0}, {0}, {0}, {0}}; // pieces pinned on the line of each direction
+    for (int dir = 0; dir < 8; dir ++) {
+        lanes kingRay = fill_attacks(king, empty, dir);
+        lanes meet = kingRay & theirRays[(dir + 4) % 8];
+        checkers |= kingRay & (dir & 1 ? theirDiagonal : theirStraight);
+        between |= meet & empty;
+        pinned |= meet & ownPieces;
+        pinnedLines[dir % 4] |= meet & ownPieces;
+    }
+
+    // other pieces must capture a single checker or block it, and cannot move in double check
+    lanes noCheck = (lanes) (checkers == 0);
+    lanes singleCheck = (lanes) ((checkers & (checkers - 1)) == 0);
+    lanes mask = noCheck | (singleCheck & (checkers | between));
+    lanes allowed = ~ownPieces & mask;
+    pinned &= singleCheck; // only the king moves in double check, so nothing is reported as pinned
+
+    int counts[BATCH_LANES];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < 8; i ++) {
+        // each jump and step reaches distinct squares from distinct pieces, so the moves are counted by direction
+        add_counts(counts, shift_lanes(own[1] & ~pinned, knightShifts[i]) & knightMasks[i] & allowed, 1);
+        add_counts(counts, shift_lanes(king, directionShifts[i]) & directionMasks[i] & ~ownPieces & ~attacked, 1);
+    }
+    for (int dir = 0; dir < 8; dir ++) {
+        // a slider is only passed through by rays of its own direction once the one in front of it is blocked by it
+        lanes sliders = dir & 1 ? ownDiagonal : ownStraight;
+        sliders = (sliders & ~pinned) | (sliders & pinnedLines[dir % 4]);
+        add_counts(counts, fill_attacks(sliders, empty, dir) & allowed, 1);
+    }
+
+    lanes pushers = own[0] & (~pinned | pinnedLines[0]);
+    lanes single = (pushers << 8) & empty;
+    lanes pawnMoves[4];
+    pawnMoves[0] = single & mask;
+    pawnMoves[1] = ((single & RANK_3) << 8) & empty & mask;
+    pawnMoves[2] = ((own[0] & (~pinned | pinnedLines[1])) << 9) & NOT_A & theirPieces & mask;
+    pawnMoves[3] = ((own[0] & (~pinned | pinnedLines[3])) << 7) & NOT_H & theirPieces & mask;
+    for (int i = 0; i < 4; i ++) {
+        add_counts(counts, pawnMoves[i], 1);
+        add_counts(counts, pawnMoves[i] & RANK_8, 3); // promotions to four pieces
+    }
+
+    for (int lane = 0; lane < numPositions; lane ++) {
+        chessboard* board = &boards[lane];
+        int flip = board->turn == Black;
+        uint64_t occupiedWithoutKing = occupied[lane] & ~king[lane];
+        if ((board->castling & CASTLE_KING(board->turn)) && !((attacked[lane] | occupiedWithoutKing) & 0x70)) {
+            counts[lane] ++;
+        }
+        if ((board->castling & CASTLE_QUEEN(board->turn)) && !(occupiedWithoutKing & 0x1e) && !(attacked[lane] & 0x1c)) {
+            counts[lane] ++;
+        }
+        if (board->epSquare >= 0) {
+            int epSquare = flip ? board->epSquare ^ 56 : board->epSquare;
+            int target = epSquare + 8;
+            int kingSquare = bitscan_forward(king[lane]);
+            if ((mask[lane] >> epSquare) & 1 || (mask[lane] >> target) & 1) {
+                for (uint64_t bits = pawnAttacks[target][Black] & own[0][lane]; bits; bits &= bits - 1) {
+                    uint64_t after = (occupied[lane] & ~((bits & -bits) | (1ULL << epSquare))) | (1ULL << target);
+                    if (!(get_rook_attacks_magic(after, kingSquare) & theirStraight[lane]) && !(get_bishop_attacks_magic(after, kingSquare) & theirDiagonal[lane])) {
+                        counts[lane] ++;
+                    }
+                }
+            }
+        }
+        batch->attacked[lane] = flip ? __builtin_bswap64(attacked[lane]) : attacked[lane];
+        batch->attacks[lane] = flip ? __builtin_bswap64(attacks[lane]) : attacks[lane];
+        batch->checkers[lane] = flip ? __builtin_bswap64(checkers[lane]) : checkers[lane];
+        batch->pinned[lane] = flip ? __builtin_bswap64(pinned[lane]) : pinned[lane];
+        batch->numMoves[lane] = counts[lane];
+    }
+}
+
+// positions that once disagreed with the scalar generator, checked before every bench
+const char* batchRegressionFens[] = {
+    "1R3bk1/1r5P/3p4/p1n1p2p/PB5P/4N3/3P2R1/3K4 b - - 0 53", // double check with a pinned rook
+    "3k4/3p2r1/4n3/pb5p/P1N1P2P/3P4/1R5p/1r3BK1 w - - 0 53"
+};
+
+// compare batches of boards with the scalar generator; returns the number of mismatching boards
+int check_batches(chessboard* boards, int numPositions) {
+    int mismatches = 0;
+    for (int i = 0; i < numPositions; i += BATCH_LANES) {
+        int size = numPositions - i < BATCH_LANES ? numPositions - i : BATCH_LANES;
+        moveBatch batch;
+        generate_batch(boards + i, size, &batch);
+        for (int lane = 0; lane < size; lane ++) {
+            chessboard* board = &boards[i + lane];
+            moveTargets targets;
+            get_move_targets(board, &targets);
+            uint64_t directionalAttacks[8];
+            uint64_t occupied = 0;
+            for (int piece = 0; piece < 12; piece ++) {
+                occupied |= board->pieces[piece];
+            }
+            uint64_t attacks = get_opponent_attacks(board->pieces, 1 - board->turn, occupied, directionalAttacks);
+            if (batch.numMoves[lane] != targets.numMoves || batch.attacked[lane] != targets.attacked || batch.checkers[lane] != targets.checkers ||
+                batch.pinned[lane] != targets.pinned || batch.attacks[lane] != attacks) {
+                if (mismatches < 10) {
+                    char fen[MAX_FEN_LENGTH];
+                    board_to_fen(board, fen);
+                    fprintf(stderr, "mismatch in %s: %d moves, batch counted %d\n", fen, targets.numMoves, batch.numMoves[lane]);
+                }
+                mismatches ++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// check batches against the scalar generator and compare their speed on the positions of an fen or epd file
+int batch_bench(char* path) {
+    int numRegressions = sizeof(batchRegressionFens) / sizeof(batchRegressionFens[0]);
+    chessboard regressions[sizeof(batchRegressionFens) / sizeof(batchRegressionFens[0])];
+    for (int i = 0; i < numRegressions; i ++) {
+        parse_fen((char*) batchRegressionFens[i], &regressions[i], NULL);
+    }
+    int regressionMismatches = check_batches(regressions, numRegressions);
+
+    chessboard* boards;
+    int numPositions = load_positions(path, &boards, MAX_BENCH_POSITIONS);
+    if (numPositions < 0) {
+        return 1;
+    }
+
+    int mismatches = check_batches(boards, numPositions);
+
+    uint64_t scalarMoves = 0;
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        scalarMoves += count_moves(&boards[i]);
+    }
+    long scalarTime = get_time_ms() - startTime;
+
+    uint64_t batchMoves = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i += BATCH_LANES) {
+        int size = numPositions - i < BATCH_LANES ? numPositions - i : BATCH_LANES;
+        moveBatch batch;
+        generate_batch(boards + i, size, &batch);
+        for (int lane = 0; lane < size; lane ++) {
+            batchMoves += batch.numMoves[lane];
+        }
+    }
+    long batchTime = get_time_ms() - startTime;
+
+    printf("%d regression positions, %d mismatches\n", numRegressions, regressionMismatches);
+    printf("%d positions, %d lanes, %d mismatches, %llu moves\n", numPositions, BATCH_LANES, mismatches, (unsigned long long) scalarMoves);
+    printf("scalar: %ld ms, %.2f million positions/s\n", scalarTime, numPositions / 1000.0 / (scalarTime + 1));
+    printf("batch: %ld ms, %.2f million positions/s\n", batchTime, numPositions / 1000.0 / (batchTime + 1));
+    free(boards);
+    return regressionMismatches != 0 || mismatches != 0 || batchMoves != scalarMoves;
+}
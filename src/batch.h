@@ -0,0 +1,33 @@
+#ifndef BATCH
+#define BATCH
+
+#include <stdint.h>
+#include "chess.h"
+
+// positions generated together, one in each lane of the widest vectors available
+#if defined(__AVX512F__)
+#define BATCH_LANES 8
+#elif defined(__AVX2__)
+#define BATCH_LANES 4
+#else
+#define BATCH_LANES 2 // sse2 or neon
+#endif
+
+typedef struct moveBatch moveBatch;
+
+// results of a batch in structure-of-arrays form, one entry for each position
+struct moveBatch {
+    uint64_t attacked[BATCH_LANES]; // squares attacked by the opponent, seen through the king
+    uint64_t attacks[BATCH_LANES]; // squares attacked by the side to move
+    uint64_t checkers[BATCH_LANES];
+    uint64_t pinned[BATCH_LANES];
+    int numMoves[BATCH_LANES]; // legal moves, with a move for each promotion piece
+};
+
+// generate attack maps and count legal moves of up to BATCH_LANES boards at once
+void generate_batch(chessboard* boards, int numPositions, moveBatch* batch);
+
+// check batches against the scalar generator and compare their speed on the positions of an fen or epd file
+int batch_bench(char* path);
+
+#endif
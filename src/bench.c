@@ -0,0 +1,275 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "bitscan.h"
+#include "shortlist.h"
+#include "chess.h"
+#include "search.h"
+#include "bench.h"
+
+// parse every line of an fen or epd file, reporting errors and positions per second
+int fen_bench(char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = (char*) malloc(size + 1);
+    size = fread(data, 1, size, file);
+    data[size] = '\0';
+    fclose(file);
+
+    // parse lines in place
+    int lines = 0;
+    int errors = 0;
+    long startTime = get_time_ms();
+    for (char* line = data; *line; lines ++) {
+        chessboard board;
+        fenError error = parse_fen(line, &board, NULL);
+        char* next = strchr(line, '\n');
+        if (error) {
+            if (errors < 10) {
+                fprintf(stderr, "line %d: %s\n", lines + 1, fen_error_string(error));
+            }
+            errors ++;
+        }
+        line = next ? next + 1 : line + strlen(line);
+    }
+    long parseTime = get_time_ms() - startTime;
+
+    // serialize each position and parse it again
+    int mismatches = 0;
+    startTime = get_time_ms();
+    for (char* line = data; *line; ) {
+        chessboard board;
+        chessboard copy;
+        char fen[MAX_FEN_LENGTH];
+        if (!parse_fen(line, &board, NULL)) {
+            board_to_fen(&board, fen);
+            if (parse_fen(fen, &copy, NULL) || memcmp(board.pieces, copy.pieces, sizeof(board.pieces)) || board.key != copy.key ||
+                board.halfMoveClock != copy.halfMoveClock || board.fullMoves != copy.fullMoves) {
+                mismatches ++;
+            }
+        }
+        char* next = strchr(line, '\n');
+        line = next ? next + 1 : line + strlen(line);
+    }
+    long roundTripTime = get_time_ms() - startTime;
+
+    printf("%d positions, %d errors, %d round trip mismatches\n", lines, errors, mismatches);
+    printf("parse: %ld ms, %.2f million positions/s\n", parseTime, lines / 1000.0 / (parseTime + 1));
+    printf("parse, write and parse again: %ld ms, %.2f million positions/s\n", roundTripTime, lines / 1000.0 / (roundTripTime + 1));
+    free(data);
+    return errors || mismatches;
+}
+
+int compare_moves(const void* a, const void* b) {
+    return (int) *(const unsigned short*) a - (int) *(const unsigned short*) b;
+}
+
+// compare counting moves and filling targets with generating the move list on the positions of an fen or epd file
+int movegen_bench(char* path) {
+    chessboard* boards;
+    int numPositions = load_positions(path, &boards, MAX_BENCH_POSITIONS);
+    if (numPositions < 0) {
+        return 1;
+    }
+
+    // check counts against the generator
+    int mismatches = 0;
+    moveTargets targets;
+    unsigned short previousMoves[256];
+    int previousCount = 0;
+    unsigned short* candidates = (unsigned short*) malloc(sizeof(unsigned short) * (numPositions + 1));
+    uint64_t random = 1;
+    for (int i = 0; i < numPositions; i ++) {
+        int expected;
+        unsigned short* moves = list_to_arr(get_all_moves(&boards[i]), &expected);
+        get_move_targets(&boards[i], &targets);
+        unsigned short targetMoves[256];
+        int fromTargets = get_target_moves(&boards[i], &targets, targetMoves);
+        qsort(moves, expected, sizeof(unsigned short), compare_moves);
+        qsort(targetMoves, fromTargets, sizeof(unsigned short), compare_moves);
+        int different = fromTargets != expected || memcmp(moves, targetMoves, sizeof(unsigned short) * expected);
+
+        // legal moves pass is_legal and random moves and those of the previous position match the list
+        checkInfo checks;
+        get_check_info(&boards[i], &checks);
+        for (int j = 0; j < expected; j ++) {
+            make_move(&boards[i], moves[j]);
+            int check = in_check(&boards[i]);
+            undo_move(&boards[i], moves[j]);
+            different |= !is_legal(&boards[i], &checks, moves[j]) || gives_check(&boards[i], &checks, moves[j]) != check;
+        }
+        free_board_states(&boards[i]); // only one board at a time keeps a stack
+        for (int j = 0; j < 64 + previousCount; j ++) {
+            random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+            unsigned short move = j < 64 ? random >> 48 : previousMoves[j - 64];
+            int listed = bsearch(&move, moves, expected, sizeof(unsigned short), compare_moves) != NULL;
+            different |= is_legal(&boards[i], &checks, move) != listed;
+        }
+        candidates[i] = previousCount ? previousMoves[0] : 0;
+        memcpy(previousMoves, moves, sizeof(unsigned short) * expected);
+        previousCount = expected;
+        free(moves);
+        if (count_moves(&boards[i]) != expected || targets.numMoves != expected || (targets.checkers != 0) != in_check(&boards[i]) || different) {
+            if (mismatches < 10) {
+                char fen[MAX_FEN_LENGTH];
+                board_to_fen(&boards[i], fen);
+                fprintf(stderr, "mismatch in %s: %d moves, counted %d\n", fen, expected, count_moves(&boards[i]));
+            }
+            mismatches ++;
+        }
+    }
+
+    uint64_t total = 0;
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        shortlist* moves = get_all_moves(&boards[i]);
+        total += get_list_length(moves);
+        free_list(moves);
+    }
+    long generateTime = get_time_ms() - startTime;
+
+    uint64_t counted = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        counted += count_moves(&boards[i]);
+    }
+    long countTime = get_time_ms() - startTime;
+
+    uint64_t attacked = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        get_move_targets(&boards[i], &targets);
+        attacked += popCount(targets.attacked);
+    }
+    long targetsTime = get_time_ms() - startTime;
+
+    // test the first move of the previous position, like a hash move
+    int legal = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        checkInfo checks;
+        get_check_info(&boards[i], &checks);
+        legal += is_legal(&boards[i], &checks, candidates[i]);
+    }
+    long legalTime = get_time_ms() - startTime;
+    free(candidates);
+
+    printf("%d positions, %llu moves, %d mismatches\n", numPositions, (unsigned long long) total, mismatches);
+    printf("generate: %ld ms, %.2f million positions/s\n", generateTime, numPositions / 1000.0 / (generateTime + 1));
+    printf("count: %ld ms, %.2f million positions/s\n", countTime, numPositions / 1000.0 / (countTime + 1));
+    printf("targets: %ld ms, %.2f million positions/s, %llu attacked squares\n", targetsTime, numPositions / 1000.0 / (targetsTime + 1), (unsigned long long) attacked);
+    printf("is_legal: %ld ms, %.2f million positions/s, %d legal\n", legalTime, numPositions / 1000.0 / (legalTime + 1), legal);
+    free(boards);
+    return mismatches != 0 || counted != total;
+}
+
+// time the attacks of all sliders of every board with backend, reading a random entry of pollution
+// after each board when it is not NULL to evict tables from the cache like hash table probes do
+long time_sliders(chessboard* boards, int numPositions, uint64_t (*backend)(uint64_t, int), int diagonal, uint64_t* pollution, uint64_t* checksum) {
+    uint64_t index = 1;
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t* pieces = boards[i].pieces;
+        uint64_t occupied = 0;
+        for (int piece = 0; piece < 12; piece ++) {
+            occupied |= pieces[piece];
+        }
+        uint64_t sliders = pieces[BlackQueen] | pieces[WhiteQueen] |
+            (diagonal ? pieces[BlackBishop] | pieces[WhiteBishop] : pieces[BlackRook] | pieces[WhiteRook]);
+        while (sliders) {
+            *checksum += backend(occupied, bitscan_forward(sliders));
+            sliders &= sliders - 1;
+        }
+        if (pollution) {
+            index = index * 6364136223846793005ULL + 1442695040888963407ULL;
+            *checksum += pollution[index >> 41];
+        }
+    }
+    return get_time_ms() - startTime;
+}
+
+// compare the slider backends on the positions of an fen or epd file
+int slider_bench(char* path) {
+    chessboard* boards;
+    int numPositions = load_positions(path, &boards, MAX_BENCH_POSITIONS);
+    if (numPositions < 0) {
+        return 1;
+    }
+
+    // check every square of every board against the classical attacks
+    int mismatches = 0;
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t* pieces = boards[i].pieces;
+        uint64_t occupied = 0;
+        for (int piece = 0; piece < 12; piece ++) {
+            occupied |= pieces[piece];
+        }
+        int different = 0;
+        for (int square = 0; square < 64; square ++) {
+            different |= get_bishop_attacks_magic(occupied, square) != get_bishop_attacks_classical(occupied, square) ||
+                get_bishop_attacks_obstruction(occupied, square) != get_bishop_attacks_classical(occupied, square) ||
+                get_rook_attacks_magic(occupied, square) != get_rook_attacks_classical(occupied, square) ||
+                get_rook_attacks_obstruction(occupied, square) != get_rook_attacks_classical(occupied, square);
+        }
+        for (int color = 0; color < 2; color ++) {
+            uint64_t lookup[8];
+            uint64_t fill[8];
+            get_directional_attacks_lookup(pieces[BlackBishop + color], pieces[BlackRook + color], pieces[BlackQueen + color], occupied, lookup);
+            get_directional_attacks_fill(pieces[BlackBishop + color], pieces[BlackRook + color], pieces[BlackQueen + color], occupied, fill);
+            different |= memcmp(lookup, fill, sizeof(lookup)) != 0;
+        }
+        mismatches += different;
+    }
+
+    uint64_t checksum = 0;
+    char* names[3] = {"classical", "obstruction difference", get_slider_backend()};
+    uint64_t (*bishopBackends[3])(uint64_t, int) = {get_bishop_attacks_classical, get_bishop_attacks_obstruction, get_bishop_attacks_magic};
+    uint64_t (*rookBackends[3])(uint64_t, int) = {get_rook_attacks_classical, get_rook_attacks_obstruction, get_rook_attacks_magic};
+    uint64_t* pollution = (uint64_t*) malloc(sizeof(uint64_t) << 23); // 64 MB, like a hash table
+    for (uint64_t i = 0; i < 1ULL << 23; i ++) {
+        pollution[i] = i;
+    }
+    printf("%d positions, %d mismatches\n", numPositions, mismatches);
+    for (int backend = 0; backend < 3; backend ++) {
+        long time = time_sliders(boards, numPositions, bishopBackends[backend], 1, NULL, &checksum) +
+            time_sliders(boards, numPositions, rookBackends[backend], 0, NULL, &checksum);
+        long pollutedTime = time_sliders(boards, numPositions, bishopBackends[backend], 1, pollution, &checksum) +
+            time_sliders(boards, numPositions, rookBackends[backend], 0, pollution, &checksum);
+        printf("%-30s %ld ms, with hash table reads %ld ms\n", names[backend], time, pollutedTime);
+    }
+    free(pollution);
+
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t attacks[8];
+        get_directional_attacks_lookup(boards[i].pieces[WhiteBishop], boards[i].pieces[WhiteRook], boards[i].pieces[WhiteQueen], boards[i].pieces[BlackPawn] | boards[i].pieces[WhitePawn], attacks);
+        checksum += attacks[i & 7];
+    }
+    long lookupTime = get_time_ms() - startTime;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t attacks[8];
+        get_directional_attacks_fill(boards[i].pieces[WhiteBishop], boards[i].pieces[WhiteRook], boards[i].pieces[WhiteQueen], boards[i].pieces[BlackPawn] | boards[i].pieces[WhitePawn], attacks);
+        checksum += attacks[i & 7];
+    }
+    long fillTime = get_time_ms() - startTime;
+    printf("directional attacks: per piece %ld ms, kogge-stone fill %ld ms (%llx)\n", lookupTime, fillTime, (unsigned long long) checksum);
+
+    chessboard board;
+    parse_fen(START_FEN, &board, NULL);
+    startTime = get_time_ms();
+    uint64_t nodes = perft(&board, 5);
+    long perftTime = get_time_ms() - startTime;
+    free_board_states(&board);
+    printf("perft 5 with %s: %llu nodes, %ld ms, %.1f million nps\n", get_slider_backend(), (unsigned long long) nodes, perftTime, nodes / 1000.0 / (perftTime + 1));
+    printf("slider tables: %zu bytes\n", get_slider_table_size());
+    free(boards);
+    return mismatches != 0;
+}
@@ -0,0 +1,16 @@
+#ifndef BENCH
+#define BENCH
+
+// parse every line of an fen or epd file, write each position back and parse it again;
+// reports errors, round trip mismatches and positions per second, returns nonzero on any
+int fen_bench(char* path);
+
+// check counting moves, move targets, is_legal and gives_check against the move list on the positions
+// of an fen or epd file and time each of them; returns nonzero on a mismatch
+int movegen_bench(char* path);
+
+// check the slider backends against the classical ray attacks on the positions of an fen or epd file
+// and time them with and without cache pollution; returns nonzero on a mismatch
+int slider_bench(char* path);
+
+#endif
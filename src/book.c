@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chess.h"
+#include "search.h"
+#include "pgn.h"
+#include "pack.h"
+#include "book.h"
+
+_Static_assert(sizeof(bookEntry) == 32, "book entries are 32 bytes");
+
+typedef struct bookBuilder bookBuilder;
+
+// one entry per move replayed, merged after sorting
+struct bookBuilder {
+    bookEntry* entries;
+    uint64_t numEntries;
+    uint64_t capacity;
+    int maxPlies;
+    pthread_mutex_t lock; // pgn games are replayed on several threads
+};
+
+void add_book_move(chessboard* board, unsigned short move, int ply, gameResult result, void* data) {
+    bookBuilder* builder = (bookBuilder*) data;
+    if (ply >= builder->maxPlies) {
+        return;
+    }
+    bookEntry entry = {board->key, 1, 0, 0, 0, move, {0, 0, 0}};
+    if (result == ResultDraw) {
+        entry.draws = 1;
+    } else if (result == (board->turn == White ? ResultWhiteWins : ResultBlackWins)) {
+        entry.wins = 1;
+    } else if (result != ResultUnknown) {
+        entry.losses = 1;
+    }
+    pthread_mutex_lock(&builder->lock);
+    if (builder->numEntries == builder->capacity) {
+        builder->capacity *= 2;
+        builder->entries = (bookEntry*) realloc(builder->entries, sizeof(bookEntry) * builder->capacity);
+    }
+    builder->entries[builder->numEntries ++] = entry;
+    pthread_mutex_unlock(&builder->lock);
+}
+
+// order by key, then move
+int compare_book_moves(const void* a, const void* b) {
+    const bookEntry* x = (const bookEntry*) a;
+    const bookEntry* y = (const bookEntry*) b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (int) x->move - (int) y->move;
+}
+
+// order by key, then most played
+int compare_book_entries(const void* a, const void* b) {
+    const bookEntry* x = (const bookEntry*) a;
+    const bookEntry* y = (const bookEntry*) b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->games != y->games ? (x->games > y->games ? -1 : 1) : (int) x->move - (int) y->move;
+}
+
+// replay games of a binary game file
+int read_book_games(char* path, bookBuilder* builder, pgnStats* stats) {
+    gameReader* reader = open_game_reader(path);
+    if (!reader) {
+        return 1;
+    }
+    gameRecord record;
+    while (next_game(reader, &record) == 0) {
+        chessboard board;
+        stats->games ++;
+        if (unpack_position(&record.start, &board)) {
+            stats->errors ++;
+            continue;
+        }
+        for (int i = 0; i < record.numMoves; i ++) {
+            unsigned short move = get_record_move(&record, i);
+            add_book_move(&board, move, i, record.result, builder);
+            make_move(&board, move);
+        }
+        stats->plies += record.numMoves;
+        free_board_states(&board);
+    }
+    close_game_reader(reader);
+    return 0;
+}
+
+// build book from the moves of a pgn file or binary game file within maxPlies of the start,
+// keeping moves played in at least minGames games; returns 0 on success
+int build_book(char* gamesPath, char* bookPath, int maxPlies, int minGames) {
+    long startTime = get_time_ms();
+    bookBuilder builder;
+    builder.capacity = 1 << 16;
+    builder.entries = (bookEntry*) malloc(sizeof(bookEntry) * builder.capacity);
+    builder.numEntries = 0;
+    builder.maxPlies = maxPlies;
+    pthread_mutex_init(&builder.lock, NULL);
+
+    pgnStats stats = {0, 0, 0};
+    int length = strlen(gamesPath);
+    int error;
+    if (length >= 4 && strcmp(gamesPath + length - 4, ".pgn") == 0) {
+        error = read_pgn(gamesPath, sysconf(_SC_NPROCESSORS_ONLN), add_book_move, &builder, &stats);
+    } else {
+        error = read_book_games(gamesPath, &builder, &stats);
+    }
+    pthread_mutex_destroy(&builder.lock);
+    if (error) {
+        free(builder.entries);
+        return 1;
+    }
+
+    // merge equal moves of equal positions
+    uint64_t replayed = builder.numEntries;
+    qsort(builder.entries, builder.numEntries, sizeof(bookEntry), compare_book_moves);
+    uint64_t numEntries = 0;
+    for (uint64_t i = 0; i < builder.numEntries; i ++) {
+        bookEntry* entry = &builder.entries[i];
+        bookEntry* last = numEntries ? &builder.entries[numEntries - 1] : NULL;
+        if (last && last->key == entry->key && last->move == entry->move) {
+            last->games += entry->games;
+            last->wins += entry->wins;
+            last->draws += entry->draws;
+            last->losses += entry->losses;
+        } else {
+            builder.entries[numEntries ++] = *entry;
+        }
+    }
+    uint64_t kept = 0;
+    for (uint64_t i = 0; i < numEntries; i ++) {
+        if (builder.entries[i].games >= (uint32_t) minGames) {
+            builder.entries[kept ++] = builder.entries[i];
+        }
+    }
+    qsort(builder.entries, kept, sizeof(bookEntry), compare_book_entries);
+
+    FILE* file = fopen(bookPath, "wb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", bookPath);
+        free(builder.entries);
+        return 1;
+    }
+    uint32_t header[2] = {BOOK_MAGIC, BOOK_VERSION};
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(&kept, sizeof(kept), 1, file);
+    error = fwrite(builder.entries, sizeof(bookEntry), kept, file) != kept;
+    error |= fclose(file) != 0;
+    free(builder.entries);
+    if (error) {
+        fprintf(stderr, "cannot write %s\n", bookPath);
+        return 1;
+    }
+    printf("%llu games, %llu errors, %llu book moves replayed, %llu entries written, %ld ms\n", (unsigned long long) stats.games, (unsigned long long) stats.errors,
+        (unsigned long long) replayed, (unsigned long long) kept, get_time_ms() - startTime);
+    return 0;
+}
+
+// memory-map book; returns NULL if it cannot be read
+openingBook* open_book(char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0 || info.st_size < BOOK_HEADER_SIZE) {
+        fprintf(stderr, "cannot open %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return NULL;
+    }
+    const uint32_t* header = (const uint32_t*) mapping;
+    uint64_t numEntries = *(const uint64_t*) (header + 2);
+    if (header[0] != BOOK_MAGIC || header[1] != BOOK_VERSION || BOOK_HEADER_SIZE + numEntries * sizeof(bookEntry) != (uint64_t) info.st_size) {
+        fprintf(stderr, "%s is not a book of version %d\n", path, BOOK_VERSION);
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+    openingBook* book = (openingBook*) malloc(sizeof(openingBook));
+    book->mapping = mapping;
+    book->size = info.st_size;
+    book->entries = (const bookEntry*) ((const char*) mapping + BOOK_HEADER_SIZE);
+    book->numEntries = numEntries;
+    return book;
+}
+
+void close_book(openingBook* book) {
+    if (book) {
+        munmap(book->mapping, book->size);
+        free(book);
+    }
+}
+
+// find entries of key by binary search; returns their number and sets first
+int probe_book(openingBook* book, uint64_t key, const bookEntry** first) {
+    uint64_t low = 0;
+    uint64_t high = book->numEntries;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (book->entries[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *first = book->entries + low;
+    int count = 0;
+    while (low + count < book->numEntries && book->entries[low + count].key == key) {
+        count ++;
+    }
+    return count;
+}
+
+// pick legal book move with probability proportional to its games, or 0 if there is none
+unsigned short get_book_move(openingBook* book, chessboard* board, uint64_t* seed) {
+    const bookEntry* entries;
+    int count = probe_book(book, board->key, &entries);
+    if (count == 0) {
+        return 0;
+    }
+    // moves of another position with the same key are skipped
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+    uint64_t total = 0;
+    unsigned short legal[count];
+    uint32_t games[count];
+    int numLegal = 0;
+    for (int i = 0; i < count; i ++) {
+        for (int j = 0; j < numMoves; j ++) {
+            if (moves[j] == entries[i].move) {
+                legal[numLegal] = entries[i].move;
+                games[numLegal ++] = entries[i].games;
+                total += entries[i].games;
+                break;
+            }
+        }
+    }
+    free(moves);
+    if (numLegal == 0) {
+        return 0;
+    }
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    uint64_t pick = *seed % total;
+    int i = 0;
+    while (pick >= games[i]) {
+        pick -= games[i ++];
+    }
+    return legal[i];
+}
+
+// print book moves of fen and time lookups of every key in the book
+int book_probe_fen(char* path, char* fen) {
+    chessboard board;
+    fenError error = parse_fen(fen, &board, NULL);
+    if (error) {
+        fprintf(stderr, "invalid fen \"%s\": %s\n", fen, fen_error_string(error));
+        return 1;
+    }
+    openingBook* book = open_book(path);
+    if (!book) {
+        return 1;
+    }
+    const bookEntry* entries;
+    int count = probe_book(book, board.key, &entries);
+    // moves of another position with the same key are skipped, as in get_book_move
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(&board), &numMoves);
+    int printed = 0;
+    for (int i = 0; i < count; i ++) {
+        const bookEntry* entry = &entries[i];
+        int legal = 0;
+        for (int j = 0; j < numMoves; j ++) {
+            legal |= moves[j] == entry->move;
+        }
+        if (!legal) {
+            continue;
+        }
+        char san[MAX_SAN_LENGTH];
+        move_to_san(&board, entry->move, san);
+        printf("%-8s games %u, won %u, drawn %u, lost %u\n", san, entry->games, entry->wins, entry->draws, entry->losses);
+        printed ++;
+    }
+    free(moves);
+    free_board_states(&board);
+    if (printed == 0) {
+        printf("not in book\n");
+    }
+
+    long startTime = get_time_ms();
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < book->numEntries; i ++) {
+        found += probe_book(book, book->entries[i].key, &entries) > 0;
+    }
+    long elapsed = get_time_ms() - startTime;
+    printf("%llu entries, %llu lookups in %ld ms, %.2f million lookups/s\n", (unsigned long long) book->numEntries,
+        (unsigned long long) found, elapsed, book->numEntries / 1000.0 / (elapsed + 1));
+    close_book(book);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef BOOK
+#define BOOK
+
+#include <stdint.h>
+#include <stddef.h>
+#include "chess.h"
+
+#define BOOK_MAGIC 0x4b4f4243 // "CBOK"
+#define BOOK_VERSION 2 // zobrist keys of version 1 came from rand()
+#define BOOK_HEADER_SIZE 16 // magic, version, number of entries
+#define BOOK_MAX_PLIES 24 // default depth of built books
+
+typedef struct bookEntry bookEntry;
+
+// statistics of one move from one position; entries are sorted by key, then most played first
+struct bookEntry {
+    uint64_t key; // zobrist key of position
+    uint32_t games; // including games without a result
+    uint32_t wins; // won by the side to move
+    uint32_t draws;
+    uint32_t losses;
+    uint16_t move;
+    uint16_t reserved[3];
+};
+
+typedef struct openingBook openingBook;
+
+// entries point into the mapped file
+struct openingBook {
+    void* mapping;
+    size_t size;
+    const bookEntry* entries;
+    uint64_t numEntries;
+};
+
+// build book from the moves of a pgn file or binary game file within maxPlies of the start,
+// keeping moves played in at least minGames games; returns 0 on success
+int build_book(char* gamesPath, char* bookPath, int maxPlies, int minGames);
+
+// memory-map book; returns NULL if it cannot be read
+openingBook* open_book(char* path);
+
+void close_book(openingBook* book);
+
+// find entries of key by binary search; returns their number and sets first
+int probe_book(openingBook* book, uint64_t key, const bookEntry** first);
+
+// pick legal book move with probability proportional to its games, or 0 if there is none
+unsigned short get_book_move(openingBook* book, chessboard* board, uint64_t* seed);
+
+// print book moves of fen and time lookups of every key in the book
+int book_probe_fen(char* path, char* fen);
+
+#endif
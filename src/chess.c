@@ -1,42 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "bitscan.h"
 #include "shortlist.h"
-
-typedef enum pieceColor pieceColor;
-
-enum pieceColor {
-    White, Black
-};
-
-typedef enum enumPiece enumPiece;
-
-enum enumPiece {
-    BlackPawn, WhitePawn, BlackKnight, WhiteKnight, BlackBishop, WhiteBishop, BlackRook, WhiteRook, BlackQueen, WhiteQueen, BlackKing, WhiteKing
-};
-
-typedef struct board chessboard;
-
-struct board {
-    uint64_t pieces[12];
-    pieceColor turn;
-    unsigned short castleKing[2];
-    unsigned short castleQueen[2];
-    int epSquare;
-    int halfMoveClock;
-    int fullMoves;
-    shortlist* captureLog;
-    shortlist* captureLogTail;
-    shortlist* castleKingLog;
-    shortlist* castleKingLogTail;
-    shortlist* castleQueenLog;
-    shortlist* castleQueenLogTail;
-    shortlist* epLog;
-    shortlist* epLogTail;
-    shortlist* halfMoveClockLog;
-    shortlist* halfMoveClockLogTail;
-};
+#include "chess.h"
+#include "eval.h"
+#include "nnue.h"
 
 void print_bitboard(uint64_t bitboard) {
     for (int row = 7; row >= 0; row --) {
@@ -51,121 +22,391 @@ void print_bitboard(uint64_t bitboard) {
     }
 }
 
-// get a new chess board from fen
-chessboard new_board(char* fen) {
-    chessboard board;
+// piece index + 1 of each fen character, 0 if it is not a piece
+const signed char fenPieces[256] = {
+    ['p'] = BlackPawn + 1, ['P'] = WhitePawn + 1, ['n'] = BlackKnight + 1, ['N'] = WhiteKnight + 1,
+    ['b'] = BlackBishop + 1, ['B'] = WhiteBishop + 1, ['r'] = BlackRook + 1, ['R'] = WhiteRook + 1,
+    ['q'] = BlackQueen + 1, ['Q'] = WhiteQueen + 1, ['k'] = BlackKing + 1, ['K'] = WhiteKing + 1
+};
+
+const char* pieceChars = "pPnNbBrRqQkK";
+
+const char* fen_error_string(fenError error) {
+    switch (error) {
+        case FenOk:
+            return "ok";
+        case FenMissingField:
+            return "missing field";
+        case FenBadPiece:
+            return "invalid piece character";
+        case FenBadRank:
+            return "rank does not have 8 squares or board does not have 8 ranks";
+        case FenBadSide:
+            return "side to move is not w or b";
+        case FenBadCastling:
+            return "invalid castling rights or king and rook are not on their squares";
+        case FenBadEnPassant:
+            return "invalid en passant square";
+        case FenBadClock:
+            return "invalid move clock";
+        case FenBadKings:
+            return "each side needs exactly one king";
+        case FenBadPawns:
+            return "pawn on first or last rank";
+        case FenOpponentInCheck:
+            return "side not to move is in check";
+    }
+    return "unknown error";
+}
+
+int is_fen_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// check if field ends at c
+int is_field_end(char c) {
+    return is_fen_space(c) || c == '\0' || c == '\n' || c == '\r' || c == ';';
+}
+
+// parse clock starting at *ptr, advancing it past the digits
+fenError parse_clock(char** ptr, int* clock) {
+    char* c = *ptr;
+    int value = 0;
+    int digits = 0;
+    while (*c >= '0' && *c <= '9') {
+        if (++ digits > 9) {
+            return FenBadClock;
+        }
+        value = value * 10 + (*c - '0');
+        c ++;
+    }
+    if (!is_field_end(*c)) {
+        return FenBadClock;
+    }
+    *clock = value;
+    *ptr = c;
+    return FenOk;
+}
+
+// parse and validate fen or the first four fields of an epd line into board
+// clocks are optional; if endPtr is given it is set to the first character after the fields read
+fenError parse_fen(char* fen, chessboard* board, char** endPtr) {
     for (int i = 0; i < 12; i ++) {
-        board.pieces[i] = 0LL;
+        board->pieces[i] = 0;
+    }
+    char* c = fen;
+    while (is_fen_space(*c)) {
+        c ++;
+    }
+    if (is_field_end(*c)) {
+        return FenMissingField;
     }
-    int row = 7; 
+
+    // piece placement from rank 8 to rank 1
+    int row = 7;
     int col = 0;
-    int i = 0;
-    while (fen[i] != ' ') {
-        if (fen[i] == '/') {
+    for (; !is_field_end(*c); c ++) {
+        if (*c == '/') {
+            if (col != 8 || row == 0) {
+                return FenBadRank;
+            }
             row --;
             col = 0;
-        } else if (fen[i] > '0' && fen[i] < '9') {
-            col += fen[i] - '0';
+        } else if (*c >= '1' && *c <= '8') {
+            col += *c - '0';
+            if (col > 8) {
+                return FenBadRank;
+            }
         } else {
-            uint64_t square = 1LL << (row * 8 + col);
-            switch (fen[i]) {
-                case 'P':
-                    board.pieces[WhitePawn] |= square;
-                    break;
-                case 'p':
-                    board.pieces[BlackPawn] |= square;
-                    break;
-                case 'R':
-                    board.pieces[WhiteRook] |= square;
-                    break;
-                case 'r':
-                    board.pieces[BlackRook] |= square;
-                    break;
-                case 'B':
-                    board.pieces[WhiteBishop] |= square;
-                    break;
-                case 'b':
-                    board.pieces[BlackBishop] |= square;
-                    break;
-                case 'N':
-                    board.pieces[WhiteKnight] |= square;
-                    break;
-                case 'n':
-                    board.pieces[BlackKnight] |= square;
-                    break;
-                case 'Q':
-                    board.pieces[WhiteQueen] |= square;
-                    break;
-                case 'q':
-                    board.pieces[BlackQueen] |= square;
-                    break;
-                case 'K':
-                    board.pieces[WhiteKing] |= square;
-                    break;
-                case 'k':
-                    board.pieces[BlackKing] |= square;
+            int piece = fenPieces[(unsigned char) *c] - 1;
+            if (piece < 0) {
+                return FenBadPiece;
+            }
+            if (col == 8) {
+                return FenBadRank;
             }
+            board->pieces[piece] |= 1ULL << (row * 8 + col);
             col ++;
         }
-        i ++;
+    }
+    if (row != 0 || col != 8) {
+        return FenBadRank;
     }
 
-    board.turn = fen[++i] == 'w' ? White : Black;
-
-    i += 2;
+    // side to move
+    while (is_fen_space(*c)) {
+        c ++;
+    }
+    if ((*c != 'w' && *c != 'b') || !is_field_end(c[1])) {
+        return is_field_end(*c) ? FenMissingField : FenBadSide;
+    }
+    board->turn = *c == 'w' ? White : Black;
+    c ++;
 
-    if (fen[i] == '-') {
-        board.castleKing[White] = 0;
-        board.castleKing[Black] = 0;
-        board.castleQueen[White] = 0;
-        board.castleQueen[Black] = 0;
-        i ++;
+    // castling rights
+    while (is_fen_space(*c)) {
+        c ++;
+    }
+    board->castling = 0;
+    if (*c == '-') {
+        c ++;
     } else {
-        while (fen[i] != ' ') {
-            switch (fen[i]) {
+        for (; !is_field_end(*c); c ++) {
+            int right;
+            switch (*c) {
                 case 'K':
-                    board.castleKing[White] = 1;
+                    right = CASTLE_KING(White);
                     break;
                 case 'Q':
-                    board.castleQueen[White] = 1;
+                    right = CASTLE_QUEEN(White);
                     break;
                 case 'k':
-                    board.castleKing[Black] = 1;
+                    right = CASTLE_KING(Black);
                     break;
                 case 'q':
-                    board.castleQueen[Black] = 1;
+                    right = CASTLE_QUEEN(Black);
+                    break;
+                default:
+                    return FenBadCastling;
             }
-            i ++;
+            if (board->castling & right) {
+                return FenBadCastling; // repeated
+            }
+            board->castling |= right;
         }
     }
+    if (!is_field_end(*c)) {
+        return FenBadCastling;
+    }
 
-    if (fen[++i] == '-') {
-        board.epSquare = -1;
+    // en passant target square, stored as the square of the pawn that moved
+    while (is_fen_space(*c)) {
+        c ++;
+    }
+    if (*c == '-') {
+        board->epSquare = -1;
+        c ++;
+    } else if (*c >= 'a' && *c <= 'h' && c[1] == (board->turn == White ? '6' : '3')) {
+        int target = (*c - 'a') + (c[1] - '1') * 8;
+        board->epSquare = board->turn == White ? target - 8 : target + 8;
+        c += 2;
     } else {
-        board.epSquare = (fen[i] - 'a') + (fen[i + 1] - '1') * 8;
-        i ++;
-    }
-
-    i += 2;
-    board.halfMoveClock = fen[i] - '0';
-    i += 2;
-    board.fullMoves = fen[i] - '0';
-
-    board.captureLog = NULL;
-    board.captureLogTail = NULL;
-    board.castleKingLog = NULL;
-    board.castleKingLogTail = NULL;
-    board.castleQueenLog = NULL;
-    board.castleQueenLogTail = NULL;
-    board.epLog = NULL;
-    board.epLogTail = NULL;
-    board.halfMoveClockLog = NULL;
-    board.halfMoveClockLogTail = NULL;
-    
-    return board;
+        return is_field_end(*c) ? FenMissingField : FenBadEnPassant;
+    }
+    if (!is_field_end(*c)) {
+        return FenBadEnPassant;
+    }
+
+    // optional clocks
+    board->halfMoveClock = 0;
+    board->fullMoves = 1;
+    while (is_fen_space(*c)) {
+        c ++;
+    }
+    if (*c >= '0' && *c <= '9') {
+        if (parse_clock(&c, &board->halfMoveClock)) {
+            return FenBadClock;
+        }
+        while (is_fen_space(*c)) {
+            c ++;
+        }
+        if (*c >= '0' && *c <= '9') {
+            if (parse_clock(&c, &board->fullMoves)) {
+                return FenBadClock;
+            }
+            if (board->fullMoves == 0) {
+                board->fullMoves = 1;
+            }
+            while (is_fen_space(*c)) {
+                c ++;
+            }
+        }
+    }
+    if (endPtr) {
+        *endPtr = c;
+    }
+
+    fenError error = validate_board(board);
+    if (error) {
+        return error;
+    }
+    init_board(board);
+    return FenOk;
+}
+
+// check that kings, pawns, castling rights and en passant square are possible
+fenError validate_board(chessboard* board) {
+    uint64_t* pieces = board->pieces;
+    if (popCount(pieces[WhiteKing]) != 1 || popCount(pieces[BlackKing]) != 1) {
+        return FenBadKings;
+    }
+    if ((pieces[WhitePawn] | pieces[BlackPawn]) & 0xFF000000000000FFULL) {
+        return FenBadPawns;
+    }
+    if (((board->castling & CASTLE_KING(White)) && !(pieces[WhiteKing] >> e1 & pieces[WhiteRook] >> h1 & 1)) ||
+        ((board->castling & CASTLE_QUEEN(White)) && !(pieces[WhiteKing] >> e1 & pieces[WhiteRook] >> a1 & 1)) ||
+        ((board->castling & CASTLE_KING(Black)) && !(pieces[BlackKing] >> e8 & pieces[BlackRook] >> h8 & 1)) ||
+        ((board->castling & CASTLE_QUEEN(Black)) && !(pieces[BlackKing] >> e8 & pieces[BlackRook] >> a8 & 1))) {
+        return FenBadCastling;
+    }
+    if (board->epSquare >= 0) {
+        uint64_t occupied = 0;
+        for (int i = 0; i < 12; i ++) {
+            occupied |= pieces[i];
+        }
+        // the pawn that moved must be there and the two squares it passed must be empty
+        uint64_t passed = board->turn == White ? 0x101ULL << (board->epSquare + 8) : 0x101ULL << (board->epSquare - 16);
+        if (!(pieces[board->turn == White ? BlackPawn : WhitePawn] >> board->epSquare & 1) || (occupied & passed)) {
+            return FenBadEnPassant;
+        }
+    }
+    int opponentKing = bitscan_forward(pieces[board->turn == White ? BlackKing : WhiteKing]);
+    if (is_square_attacked(board, opponentKing, board->turn)) {
+        return FenOpponentInCheck;
+    }
+    return FenOk;
+}
+
+// set empty state stack, keys and evaluation of board from its pieces and state
+void init_board(chessboard* board) {
+    board->states = NULL;
+    board->numStates = 0;
+    board->maxStates = 0;
+
+    board->key = get_key(board);
+    board->pawnKey = get_pawn_key(board);
+    board->accumulator = NULL;
+    init_eval(board);
+}
+
+// get board from fen; prints the error and returns the starting position if it is invalid
+chessboard new_board(char* fen) {
+    chessboard board;
+    fenError error = parse_fen(fen, &board, NULL);
+    if (error) {
+        fprintf(stderr, "invalid fen \"%s\": %s\n", fen, fen_error_string(error));
+        parse_fen(START_FEN, &board, NULL);
+    }
     return board;
 }
 
+// parse the valid lines of an fen or epd file into a new array of at most maxPositions boards
+int load_positions(char* path, chessboard** boards, int maxPositions) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    int capacity = 1024;
+    int numPositions = 0;
+    chessboard* loaded = (chessboard*) malloc(sizeof(chessboard) * capacity);
+    char line[1024];
+    while (loaded && numPositions < maxPositions && fgets(line, sizeof(line), file)) {
+        if (numPositions == capacity) {
+            capacity = capacity > maxPositions / 2 ? maxPositions : capacity * 2;
+            chessboard* grown = (chessboard*) realloc(loaded, sizeof(chessboard) * capacity);
+            if (!grown) {
+                free(loaded);
+                loaded = NULL;
+                break;
+            }
+            loaded = grown;
+        }
+        if (!parse_fen(line, &loaded[numPositions], NULL)) {
+            numPositions ++;
+        }
+    }
+    fclose(file);
+    if (!loaded) {
+        fprintf(stderr, "out of memory for %d positions\n", capacity);
+        return -1;
+    }
+    *boards = loaded;
+    return numPositions;
+}
+
+// write fen of board to str, which needs MAX_FEN_LENGTH characters; returns its length
+int board_to_fen(chessboard* board, char* str) {
+    char* c = str;
+    for (int row = 7; row >= 0; row --) {
+        int empty = 0;
+        for (int col = 0; col < 8; col ++) {
+            uint64_t square = 1ULL << (row * 8 + col);
+            int piece = -1;
+            for (int i = 0; i < 12; i ++) {
+                if (board->pieces[i] & square) {
+                    piece = i;
+                    break;
+                }
+            }
+            if (piece < 0) {
+                empty ++;
+            } else {
+                if (empty) {
+                    *c ++ = '0' + empty;
+                    empty = 0;
+                }
+                *c ++ = pieceChars[piece];
+            }
+        }
+        if (empty) {
+            *c ++ = '0' + empty;
+        }
+        if (row) {
+            *c ++ = '/';
+        }
+    }
+    *c ++ = ' ';
+    *c ++ = board->turn == White ? 'w' : 'b';
+    *c ++ = ' ';
+    if (!board->castling) {
+        *c ++ = '-';
+    } else {
+        if (board->castling & CASTLE_KING(White)) {
+            *c ++ = 'K';
+        }
+        if (board->castling & CASTLE_QUEEN(White)) {
+            *c ++ = 'Q';
+        }
+        if (board->castling & CASTLE_KING(Black)) {
+            *c ++ = 'k';
+        }
+        if (board->castling & CASTLE_QUEEN(Black)) {
+            *c ++ = 'q';
+        }
+    }
+    *c ++ = ' ';
+    if (board->epSquare < 0) {
+        *c ++ = '-';
+    } else {
+        int target = board->turn == White ? board->epSquare + 8 : board->epSquare - 8;
+        *c ++ = 'a' + (target & 7);
+        *c ++ = '1' + (target >> 3);
+    }
+    c += sprintf(c, " %d %d", board->halfMoveClock, board->fullMoves);
+    return c - str;
+}
+
+// free state stack of moves made on board
+void free_board_states(chessboard* board) {
+    free(board->states);
+    board->states = NULL;
+    board->numStates = 0;
+    board->maxStates = 0;
+}
+
+// copy board with its own state stack, so moves can be made on both
+void copy_board(chessboard* copy, chessboard* board) {
+    *copy = *board;
+    copy->states = NULL;
+    copy->maxStates = 0;
+    if (board->numStates) {
+        copy->maxStates = board->maxStates;
+        copy->states = (boardState*) malloc(sizeof(boardState) * copy->maxStates);
+        memcpy(copy->states, board->states, sizeof(boardState) * board->numStates);
+    }
+}
+
 // get piece at square on chess board
 unsigned short get_board_piece(chessboard* board, unsigned short square) {
     uint64_t allPieces[12] = {
@@ -200,28 +441,13 @@ void print_board(chessboard* board) {
     }
 }
 
-typedef enum enumSquare enumSquare;
-
-enum enumSquare {
-    a1, b1, c1, d1, e1, f1, g1, h1,
-    a2, b2, c2, d2, e2, f2, g2, h2,
-    a3, b3, c3, d3, e3, f3, g3, h3,
-    a4, b4, c4, d4, e4, f4, g4, h4,
-    a5, b5, c5, d5, e5, f5, g5, h5,
-    a6, b6, c6, d6, e6, f6, g6, h6,
-    a7, b7, c7, d7, e7, f7, g7, h7,
-    a8, b8, c8, d8, e8, f8, g8, h8
-};
-
-typedef enum enumDirection enumDirection;
-
-enum enumDirection {
-    Nort, NoEa, East, SoEa, Sout, SoWe, West, NoWe
-};
-
 // attacks from each square in each direction on empty board
 uint64_t rayAttacks[64][8];
 
+// squares strictly between two squares on a line, and the whole line through them; empty if not on a line
+uint64_t between[64][64];
+uint64_t lineThrough[64][64];
+
 // attacks for sliding pieces from each square on empty board
 uint64_t emptyRookAttacks[64];
 uint64_t emptyBishopAttacks[64];
@@ -320,6 +546,20 @@ void setup_ray_attacks() {
     }
 }
 
+// setup between and line tables from ray attacks
+void setup_line_tables() {
+    for (int start = 0; start < 64; start ++) {
+        for (int dir = 0; dir < 8; dir ++) {
+            uint64_t fullLine = rayAttacks[start][dir] | rayAttacks[start][(dir + 4) % 8] | (1LL << start);
+            for (uint64_t ends = rayAttacks[start][dir]; ends; ends &= ends - 1) {
+                int end = bitscan_forward(ends);
+                between[start][end] = rayAttacks[start][dir] & ~rayAttacks[end][dir] & ~(1LL << end);
+                lineThrough[start][end] = fullLine;
+            }
+        }
+    }
+}
+
 // setup piece attacks
 void setup_piece_attacks() {
     for (int i = 0; i < 64; i ++) {
@@ -347,7 +587,7 @@ void setup_piece_attacks() {
         knightAttacks[i] |= (east | west) >> 8;
     }
 
-    for (int i = 8; i < 56; i ++) {
+    for (int i = 0; i < 64; i ++) {
         uint64_t east = east_one(1LL << i);
         uint64_t west = west_one(1LL << i);
         pawnAttacks[i][White] = (east | west) << 8;
@@ -365,6 +605,90 @@ void setup_piece_attacks() {
     }
 }
 
+// random keys for each piece on each square
+uint64_t zobristPieces[12][64];
+uint64_t zobristCastling[4];
+uint64_t zobristEp[8];
+uint64_t zobristTurn;
+uint64_t castlingKeys[16]; // xor of the castling keys of each set of rights
+
+// splitmix64, so keys do not depend on the state of rand()
+uint64_t random_uint64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// setup zobrist keys from a fixed seed
+void setup_zobrist() {
+    uint64_t state = 3;
+    for (int piece = 0; piece < 12; piece ++) {
+        for (int square = 0; square < 64; square ++) {
+            zobristPieces[piece][square] = random_uint64(&state);
+        }
+    }
+    for (int i = 0; i < 4; i ++) {
+        zobristCastling[i] = random_uint64(&state);
+    }
+    for (int file = 0; file < 8; file ++) {
+        zobristEp[file] = random_uint64(&state);
+    }
+    zobristTurn = random_uint64(&state);
+    for (int rights = 0; rights < 16; rights ++) {
+        castlingKeys[rights] = 0;
+        for (int i = 0; i < 4; i ++) {
+            if ((rights >> i) & 1) {
+                castlingKeys[rights] ^= zobristCastling[i];
+            }
+        }
+    }
+}
+
+// epSquare is the square of the pawn that moved two squares, -1 if there is none
+int can_capture_en_passant(uint64_t* pieces, pieceColor turn, int epSquare) {
+    if (epSquare < 0) {
+        return 0;
+    }
+    uint64_t pawn = 1ULL << epSquare;
+    return ((east_one(pawn) | west_one(pawn)) & pieces[turn == White ? WhitePawn : BlackPawn]) != 0;
+}
+
+// get zobrist key of side to move, castling rights and en passant square
+uint64_t get_state_key(chessboard* board) {
+    uint64_t key = (board->turn == Black ? zobristTurn : 0) ^ castlingKeys[board->castling];
+    if (can_capture_en_passant(board->pieces, board->turn, board->epSquare)) {
+        key ^= zobristEp[board->epSquare & 7];
+    }
+    return key;
+}
+
+// get zobrist key of position
+uint64_t get_key(chessboard* board) {
+    uint64_t key = get_state_key(board);
+    for (int piece = 0; piece < 12; piece ++) {
+        uint64_t bitboard = board->pieces[piece];
+        while (bitboard) {
+            key ^= zobristPieces[piece][bitscan_forward(bitboard)];
+            bitboard &= bitboard - 1;
+        }
+    }
+    return key;
+}
+
+// get zobrist key of pawn structure
+uint64_t get_pawn_key(chessboard* board) {
+    uint64_t key = 0;
+    for (int piece = BlackPawn; piece <= WhitePawn; piece ++) {
+        uint64_t pawns = board->pieces[piece];
+        while (pawns) {
+            key ^= zobristPieces[piece][bitscan_forward(pawns)];
+            pawns &= pawns - 1;
+        }
+    }
+    return key;
+}
+
 // get ray attacks in positive direction on occupied board
 uint64_t get_positive_ray_attacks(uint64_t occupied, int square, enumDirection dir) {
     uint64_t attacks = rayAttacks[square][dir];
@@ -397,6 +721,41 @@ uint64_t get_rook_attacks_classical(uint64_t occupied, int square) {
     get_negative_ray_attacks(occupied, square, West);
 }
 
+// get attacks along the line through square of directions positive and negative by obstruction difference
+// based on https://www.chessprogramming.org/Obstruction_Difference
+uint64_t get_line_attacks_obstruction(uint64_t occupied, int square, enumDirection positive, enumDirection negative) {
+    uint64_t upper = rayAttacks[square][positive] & occupied;
+    uint64_t lower = rayAttacks[square][negative] & occupied;
+    uint64_t lowerBlocker = 0x8000000000000000ULL >> __builtin_clzll(lower | 1); // nearest blocker below, or a1
+    return (rayAttacks[square][positive] | rayAttacks[square][negative]) & (upper ^ (upper - lowerBlocker));
+}
+
+uint64_t get_bishop_attacks_obstruction(uint64_t occupied, int square) {
+    return get_line_attacks_obstruction(occupied, square, NoEa, SoWe) | get_line_attacks_obstruction(occupied, square, NoWe, SoEa);
+}
+
+uint64_t get_rook_attacks_obstruction(uint64_t occupied, int square) {
+    return get_line_attacks_obstruction(occupied, square, Nort, Sout) | get_line_attacks_obstruction(occupied, square, East, West);
+}
+
+#ifdef NO_MAGICS
+#define SLIDER_BACKEND "obstruction difference build"
+
+// sliders are computed from rayAttacks alone, without the 841 KB attack table
+uint64_t get_bishop_attacks_magic(uint64_t occupied, int square) {
+    return get_bishop_attacks_obstruction(occupied, square);
+}
+
+uint64_t get_rook_attacks_magic(uint64_t occupied, int square) {
+    return get_rook_attacks_obstruction(occupied, square);
+}
+
+size_t get_slider_table_size() {
+    return sizeof(rayAttacks);
+}
+#else
+#define SLIDER_BACKEND "magic bitboards"
+
 // hash table for fancy magic bitboards
 // table contains all attacks for bishops and rooks on an occupied board
 uint64_t attackTable[107648];
@@ -572,7 +931,7 @@ void setup_attack_table() {
     for (int i = 0; i < 64; i ++) {
         uint64_t blockers = 0;
         uint64_t totalNumBlockers = 1 << bishopBits[i];
-        for (int j = 0; j < totalNumBlockers; j ++) {
+        for (uint64_t j = 0; j < totalNumBlockers; j ++) {
             set_bishop_attacks_magic(blockers, i);
             blockers = (blockers - bishopMagicTable[i].mask) & 
             bishopMagicTable[i].mask; // carry rippler trick to traverse all subsets of mask
@@ -583,7 +942,7 @@ void setup_attack_table() {
     for (int i = 0; i < 64; i ++) {
         uint64_t blockers = 0;
         uint64_t totalNumBlockers = 1 << rookBits[i];
-        for (int j = 0; j < totalNumBlockers; j ++) {
+        for (uint64_t j = 0; j < totalNumBlockers; j ++) {
             set_rook_attacks_magic(blockers, i);
             blockers = (blockers - rookMagicTable[i].mask) & 
             rookMagicTable[i].mask; // carry rippler trick to traverse all subsets of mask
@@ -591,9 +950,17 @@ void setup_attack_table() {
     }
 }
 
-uint64_t* get_directional_attacks(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied) {
-    uint64_t* attacks = (uint64_t*) malloc(sizeof(uint64_t) * 8);
+size_t get_slider_table_size() {
+    return sizeof(attackTable) + sizeof(bishopMagicTable) + sizeof(rookMagicTable);
+}
+#endif
+
+char* get_slider_backend() {
+    return SLIDER_BACKEND;
+}
 
+// get attacks of sliding pieces in each direction from the attacks of each piece
+void get_directional_attacks_lookup(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied, uint64_t* attacks) {
     for (int i = 0; i < 8; i ++) {
         attacks[i] = 0LL;
     }
@@ -637,8 +1004,59 @@ uint64_t* get_directional_attacks(uint64_t bishops, uint64_t rooks, uint64_t que
         queens &= queens - 1;
         i = bitscan_forward(queens);
     }
+}
 
-    return attacks;
+// four bitboards, one for each direction filled at once
+typedef uint64_t fourRays __attribute__((vector_size(32)));
+
+// get attacks of sliding pieces in each direction by kogge-stone fills of all sliders, four directions at a time
+// based on https://www.chessprogramming.org/Kogge-Stone_Algorithm
+void get_directional_attacks_fill(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied, uint64_t* attacks) {
+    uint64_t diagonal = bishops | queens;
+    uint64_t straight = rooks | queens;
+    uint64_t notA = 0xfefefefefefefefeULL;
+    uint64_t notH = 0x7f7f7f7f7f7f7f7fULL;
+    fourRays shifts = {8, 9, 1, 7};
+
+    // Nort, NoEa, East and NoWe shift left
+    fourRays gen = {straight, diagonal, straight, diagonal};
+    fourRays mask = {~0ULL, notA, notA, notH};
+    fourRays empty = ~occupied & mask;
+    gen |= empty & (gen << shifts);
+    empty &= empty << shifts;
+    gen |= empty & (gen << (2 * shifts));
+    empty &= empty << (2 * shifts);
+    gen |= empty & (gen << (4 * shifts));
+    fourRays positive = (gen << shifts) & mask;
+
+    // Sout, SoWe, West and SoEa shift right
+    gen = (fourRays) {straight, diagonal, straight, diagonal};
+    mask = (fourRays) {~0ULL, notH, notH, notA};
+    empty = ~occupied & mask;
+    gen |= empty & (gen >> shifts);
+    empty &= empty >> shifts;
+    gen |= empty & (gen >> (2 * shifts));
+    empty &= empty >> (2 * shifts);
+    gen |= empty & (gen >> (4 * shifts));
+    fourRays negative = (gen >> shifts) & mask;
+
+    attacks[Nort] = positive[0];
+    attacks[NoEa] = positive[1];
+    attacks[East] = positive[2];
+    attacks[NoWe] = positive[3];
+    attacks[Sout] = negative[0];
+    attacks[SoWe] = negative[1];
+    attacks[West] = negative[2];
+    attacks[SoEa] = negative[3];
+}
+
+// get attacks of sliding pieces in each direction
+void get_directional_attacks(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied, uint64_t* attacks) {
+#ifdef NO_MAGICS
+    get_directional_attacks_fill(bishops, rooks, queens, occupied, attacks);
+#else
+    get_directional_attacks_lookup(bishops, rooks, queens, occupied, attacks);
+#endif
 }
 
 uint64_t get_all_knight_attacks(uint64_t knights) {
@@ -715,29 +1133,96 @@ char* move_to_string(int move) {
     return result;
 }
 
-// get the squares attacked by opponent and get directional attacks
-uint64_t get_attacked_squares(chessboard* board, uint64_t occupied, uint64_t** directionalAttacksPtr) {
+// write move in long algebraic notation used by uci (e.g. e7e8q)
+void move_to_uci(unsigned short move, char* str) {
+    char promotions[4] = {'n', 'b', 'r', 'q'};
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    str[0] = 'a' + (start % 8);
+    str[1] = '1' + (start / 8);
+    str[2] = 'a' + (end % 8);
+    str[3] = '1' + (end / 8);
+    if (flag & 8) {
+        str[4] = promotions[flag & 3];
+        str[5] = '\0';
+    } else {
+        str[4] = '\0';
+    }
+}
+
+// get legal move written in long algebraic notation, or 0 if there is none
+unsigned short uci_to_move(chessboard* board, char* str) {
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+    unsigned short move = 0;
+    char moveStr[6];
+    for (int i = 0; i < numMoves; i ++) {
+        move_to_uci(moves[i], moveStr);
+        if (strcmp(moveStr, str) == 0) {
+            move = moves[i];
+            break;
+        }
+    }
+    free(moves);
+    return move;
+}
+
+// check if square is attacked by pieces of side
+// get pieces of side attacking square on occupied board
+uint64_t get_square_attackers(uint64_t* pieces, uint64_t occupied, int square, pieceColor side) {
+    int offset = side == White ? 1 : 0; // white pieces have odd indices
+    uint64_t diagonalSliders = pieces[BlackBishop + offset] | pieces[BlackQueen + offset];
+    uint64_t straightSliders = pieces[BlackRook + offset] | pieces[BlackQueen + offset];
+    return (knightAttacks[square] & pieces[BlackKnight + offset]) |
+    (pawnAttacks[square][1 - side] & pieces[BlackPawn + offset]) |
+    (kingAttacks[square] & pieces[BlackKing + offset]) |
+    (get_bishop_attacks_magic(occupied, square) & diagonalSliders) |
+    (get_rook_attacks_magic(occupied, square) & straightSliders);
+}
+
+int is_square_attacked(chessboard* board, int square, pieceColor side) {
+    uint64_t occupied = 0;
+    for (int i = 0; i < 12; i ++) {
+        occupied |= board->pieces[i];
+    }
+    return get_square_attackers(board->pieces, occupied, square, side) != 0;
+}
+
+// check if king of side to move is attacked
+int in_check(chessboard* board) {
+    int kingSquare = bitscan_forward(board->pieces[board->turn == White ? WhiteKing : BlackKing]);
+    return is_square_attacked(board, kingSquare, 1 - board->turn);
+}
+
+// get the squares attacked by the opponent of turn and get directional attacks
+uint64_t get_opponent_attacks(uint64_t* pieces, pieceColor turn, uint64_t occupied, uint64_t* directionalAttacks) {
     uint64_t attacked = 0LL; // all squares attacked by opponent
 
-    if (board->turn == White) {
-        *directionalAttacksPtr = get_directional_attacks(board->pieces[BlackBishop], board->pieces[BlackRook], board->pieces[BlackQueen], occupied);
-        attacked |= get_all_knight_attacks(board->pieces[BlackKnight]);
-        attacked |= get_all_pawn_attacks(board->pieces[BlackPawn], Black);
-        attacked |= get_king_attacks(board->pieces[BlackKing]);
+    if (turn == White) {
+        get_directional_attacks(pieces[BlackBishop], pieces[BlackRook], pieces[BlackQueen], occupied, directionalAttacks);
+        attacked |= get_all_knight_attacks(pieces[BlackKnight]);
+        attacked |= get_all_pawn_attacks(pieces[BlackPawn], Black);
+        attacked |= get_king_attacks(pieces[BlackKing]);
     } else {
-        *directionalAttacksPtr = get_directional_attacks(board->pieces[WhiteBishop], board->pieces[WhiteRook], board->pieces[WhiteQueen], occupied);
-        attacked |= get_all_knight_attacks(board->pieces[WhiteKnight]);
-        attacked |= get_all_pawn_attacks(board->pieces[WhitePawn], White);
-        attacked |= get_king_attacks(board->pieces[WhiteKing]);
+        get_directional_attacks(pieces[WhiteBishop], pieces[WhiteRook], pieces[WhiteQueen], occupied, directionalAttacks);
+        attacked |= get_all_knight_attacks(pieces[WhiteKnight]);
+        attacked |= get_all_pawn_attacks(pieces[WhitePawn], White);
+        attacked |= get_king_attacks(pieces[WhiteKing]);
     }
 
     for (int i = 0; i < 8; i ++) {
-        attacked |= (*directionalAttacksPtr)[i];
+        attacked |= directionalAttacks[i];
     }
 
     return attacked;
 }
 
+// get the squares attacked by opponent and get directional attacks
+uint64_t get_attacked_squares(chessboard* board, uint64_t occupied, uint64_t* directionalAttacks) {
+    return get_opponent_attacks(board->pieces, board->turn, occupied, directionalAttacks);
+}
+
 shortlist* get_pawn_pushes(uint64_t empty, uint64_t mask, int square, pieceColor turn) {
     shortlist* pawnMoves = NULL;
     int f = turn == White ? 1 : -1;
@@ -778,7 +1263,7 @@ shortlist* get_pawn_captures(uint64_t opponentPieces, int square, pieceColor tur
     uint64_t i = bitscan_forward(attacks);
     while (attacks) {
         append_list(cons(square | (i << 6), NULL), &pawnMoves, &tail);
-        if (square >= 48 - 40 * turn && square < 56 - 40 * turn) {
+        if (square >= 48 - 40 * (int) turn && square < 56 - 40 * (int) turn) {
             unsigned short flag = 0xc000;
             unsigned short move = tail->val;
             tail->val |= flag;
@@ -795,30 +1280,15 @@ shortlist* get_pawn_captures(uint64_t opponentPieces, int square, pieceColor tur
     return pawnMoves;
 }
 
-// get moves for pinned piece along diagonal and update 'allPinnedPieces'
-shortlist* get_pinned_diagonal_moves(chessboard* board, enumDirection dir, uint64_t* directionalAttacks, uint64_t kingBishopMoves, int kingSquare, uint64_t friendlyPieces, uint64_t opponentPieces, uint64_t* allPinnedPieces) {
-    uint64_t pinnedPiece = kingBishopMoves & rayAttacks[kingSquare][dir] & directionalAttacks[(dir + 4) % 8];
-    if (popCount(pinnedPiece) == 1) {
-        *allPinnedPieces |= pinnedPiece;
-        if (pinnedPiece & (board->turn == White ? board->pieces[WhiteBishop] | board->pieces[WhiteQueen] : board->pieces[BlackBishop] | board->pieces[BlackQueen])) {
-            return get_moves_from_uint64(bitscan_forward(pinnedPiece), kingBishopMoves & rayAttacks[kingSquare][dir], friendlyPieces, opponentPieces);
-        } else if (pinnedPiece & (board->turn == White ? board->pieces[WhitePawn] : board->pieces[BlackPawn])) {
-            return get_pawn_captures(opponentPieces & rayAttacks[kingSquare][dir], bitscan_forward(pinnedPiece), board->turn);
-        }
-    }
-    return NULL;
-}
-
-// get moves for pinned piece along file/rank and update 'allPinnedPieces'
-shortlist* get_pinned_straight_moves(chessboard* board, enumDirection dir, uint64_t* directionalAttacks, uint64_t kingRookMoves, int kingSquare, uint64_t friendlyPieces, uint64_t opponentPieces, uint64_t* allPinnedPieces) {
-    uint64_t pinnedPiece = kingRookMoves & rayAttacks[kingSquare][dir] & directionalAttacks[(dir + 4) % 8];
-    if (popCount(pinnedPiece) == 1) {
-        *allPinnedPieces |= pinnedPiece;
-        if (pinnedPiece & (board->turn == White ? board->pieces[WhiteRook] | board->pieces[WhiteQueen] : board->pieces[BlackRook] | board->pieces[BlackQueen])) {
-            return get_moves_from_uint64(bitscan_forward(pinnedPiece), kingRookMoves & rayAttacks[kingSquare][dir], friendlyPieces, opponentPieces);
-        }
+// get friendly pieces pinned to the king, found by x-ray attacks from the king through the first friendly blockers
+uint64_t get_pinned_pieces(uint64_t occupied, uint64_t friendlyPieces, int kingSquare, uint64_t kingBishopMoves, uint64_t kingRookMoves, uint64_t opponentDiagonalSliders, uint64_t opponentStraightSliders) {
+    uint64_t pinners = (get_bishop_attacks_magic(occupied ^ (kingBishopMoves & friendlyPieces), kingSquare) & opponentDiagonalSliders) |
+        (get_rook_attacks_magic(occupied ^ (kingRookMoves & friendlyPieces), kingSquare) & opponentStraightSliders);
+    uint64_t pinned = 0;
+    for (; pinners; pinners &= pinners - 1) {
+        pinned |= between[kingSquare][bitscan_forward(pinners)] & friendlyPieces; // none for checkers
     }
-    return NULL;
+    return pinned;
 }
 
 shortlist* get_all_bishop_moves(uint64_t bishops, uint64_t occupied, uint64_t friendlyPieces, uint64_t opponentPieces, uint64_t mask) {
@@ -860,7 +1330,7 @@ shortlist* get_all_queen_moves(uint64_t queens, uint64_t occupied, uint64_t frie
     return result;
 }
 
-shortlist* get_all_knight_moves(uint64_t knights, uint64_t occupied, uint64_t friendlyPieces, uint64_t opponentPieces, uint64_t mask) {
+shortlist* get_all_knight_moves(uint64_t knights, uint64_t friendlyPieces, uint64_t opponentPieces, uint64_t mask) {
     shortlist* result = NULL;
     shortlist* tail = NULL;
     int i = bitscan_forward(knights);
@@ -886,7 +1356,7 @@ shortlist* get_all_pawn_pushes(uint64_t pawns, uint64_t occupied, uint64_t mask,
     return result;
 }
 
-shortlist* get_all_pawn_captures(uint64_t pawns, uint64_t occupied, uint64_t opponentPieces, uint64_t mask, pieceColor turn) {
+shortlist* get_all_pawn_captures(uint64_t pawns, uint64_t opponentPieces, uint64_t mask, pieceColor turn) {
     shortlist* result = NULL;
     shortlist* tail = NULL;
     int i = bitscan_forward(pawns);
@@ -899,31 +1369,72 @@ shortlist* get_all_pawn_captures(uint64_t pawns, uint64_t occupied, uint64_t opp
     return result;
 }
 
-shortlist* get_all_pawn_en_passant(uint64_t pawns, uint64_t occupied, uint64_t opponentSliders, uint64_t pushMask, uint64_t captureMask, int kingSquare, int epSquare, pieceColor turn) {
+shortlist* get_all_pawn_en_passant(uint64_t pawns, uint64_t occupied, uint64_t opponentStraightSliders, uint64_t opponentDiagonalSliders, uint64_t pushMask, uint64_t captureMask, int kingSquare, int epSquare, pieceColor turn) {
     shortlist* result = NULL;
     shortlist* tail = NULL;
 
-    if (epSquare > 0) {
-        uint64_t leftPawn = pawns & (1LL << (epSquare - 1));
-        uint64_t rightPawn = pawns & (1LL << (epSquare + 1));
+    if (epSquare >= 0) {
         uint64_t capturePawn = 1LL << epSquare;
         int pushSquare = epSquare + 8 - 16 * turn;
-        uint64_t push = ~occupied & (1LL < pushSquare);
-        if (leftPawn && push && ((leftPawn & captureMask) || (push & pushMask))) {
-            // check for check
-            if (!(get_rook_attacks_magic(occupied & ~(leftPawn | capturePawn), kingSquare) & opponentSliders)) {
-                append_list(cons((epSquare - 1) | (pushSquare << 6) | 0x5000, NULL), &result, &tail);
+        uint64_t push = 1LL << pushSquare;
+        uint64_t capturingPawns = pawns & (east_one(capturePawn) | west_one(capturePawn));
+        if ((capturePawn & captureMask) || (push & pushMask)) {
+            int i = bitscan_forward(capturingPawns);
+            while (capturingPawns) {
+                // check for check after both pawns leave their squares
+                uint64_t after = (occupied & ~((1LL << i) | capturePawn)) | push;
+                if (!(get_rook_attacks_magic(after, kingSquare) & opponentStraightSliders) && !(get_bishop_attacks_magic(after, kingSquare) & opponentDiagonalSliders)) {
+                    append_list(cons(i | (pushSquare << 6) | 0x5000, NULL), &result, &tail);
+                }
+                capturingPawns &= capturingPawns - 1;
+                i = bitscan_forward(capturingPawns);
             }
         }
-        if (rightPawn && push && ((rightPawn & captureMask) || (push & pushMask))) {
-            // check for check
-            if (!(get_rook_attacks_magic(occupied & ~(rightPawn | capturePawn), kingSquare) & opponentSliders)) {
-                append_list(cons((epSquare + 1) | (pushSquare << 6) | 0x5000, NULL), &result, &tail);
-            }
+    }
+
+    return result;
+}
+
+// get moves out of check: safe king moves, then captures of a single checker and blocks of its ray
+shortlist* get_evasions(chessboard* board, uint64_t checkers, uint64_t kingBishopMoves, uint64_t kingRookMoves, uint64_t friendlyPieces, uint64_t opponentPieces) {
+    shortlist* moves = NULL;
+    shortlist* tail = NULL;
+    int offset = board->turn == White ? 1 : 0; // pieces of side to move have this parity
+    uint64_t occupied = friendlyPieces | opponentPieces;
+    uint64_t king = board->pieces[BlackKing + offset];
+    int kingSquare = bitscan_forward(king);
+
+    // only the squares next to the king are tested, seen through the king
+    uint64_t kingTargets = 0;
+    for (uint64_t bits = kingAttacks[kingSquare] & ~friendlyPieces; bits; bits &= bits - 1) {
+        if (!get_square_attackers(board->pieces, occupied & ~king, bitscan_forward(bits), 1 - board->turn)) {
+            kingTargets |= bits & -bits;
         }
     }
+    append_list(get_moves_from_uint64(kingSquare, kingTargets, friendlyPieces, opponentPieces), &moves, &tail);
+
+    if (checkers & (checkers - 1)) {
+        return moves; // double check; only king moves
+    }
 
-    return tail;
+    uint64_t opponentDiagonalSliders = board->pieces[WhiteBishop - offset] | board->pieces[WhiteQueen - offset];
+    uint64_t opponentStraightSliders = board->pieces[WhiteRook - offset] | board->pieces[WhiteQueen - offset];
+    uint64_t pushMask = between[kingSquare][bitscan_forward(checkers)]; // squares between checking slider and king
+
+    // pinned pieces cannot evade since their line meets the checking ray only at the king
+    uint64_t pinned = get_pinned_pieces(occupied, friendlyPieces, kingSquare, kingBishopMoves, kingRookMoves, opponentDiagonalSliders, opponentStraightSliders);
+
+    uint64_t notPinned = ~pinned;
+    uint64_t mask = pushMask | checkers;
+    append_list(get_all_bishop_moves(board->pieces[BlackBishop + offset] & notPinned, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_rook_moves(board->pieces[BlackRook + offset] & notPinned, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_queen_moves(board->pieces[BlackQueen + offset] & notPinned, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_knight_moves(board->pieces[BlackKnight + offset] & notPinned, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_pawn_pushes(board->pieces[BlackPawn + offset] & notPinned, occupied, pushMask, board->turn), &moves, &tail);
+    append_list(get_all_pawn_captures(board->pieces[BlackPawn + offset] & notPinned, opponentPieces, checkers, board->turn), &moves, &tail);
+    append_list(get_all_pawn_en_passant(board->pieces[BlackPawn + offset], occupied, opponentStraightSliders, opponentDiagonalSliders, pushMask, checkers, kingSquare, board->epSquare, board->turn), &moves, &tail);
+
+    return moves;
 }
 
 shortlist* get_all_moves(chessboard* board) {
@@ -937,96 +1448,58 @@ shortlist* get_all_moves(chessboard* board) {
     uint64_t opponentPieces = board->turn == White ? blackPieces : whitePieces;
     uint64_t occupied = friendlyPieces | opponentPieces; // all occupied squares
 
-    occupied &= board->turn == White ? ~board->pieces[WhiteKing] : ~board->pieces[BlackKing]; // remove king
+    int kingSquare = bitscan_forward(board->turn == White ? board->pieces[WhiteKing] : board->pieces[BlackKing]); // square of king
 
-    uint64_t* directionalAttacks; // attacks from each direction
-    uint64_t attacked = get_attacked_squares(board, occupied, &directionalAttacks); // all attacked squares
+    // 1. handle check
 
-    int kingSquare = bitscan_forward(board->turn == White ? board->pieces[WhiteKing] : board->pieces[BlackKing]); // square of king
-   
-    // 1. get king moves
+    // moves from king
+    uint64_t kingBishopMoves = get_bishop_attacks_magic(occupied, kingSquare);
+    uint64_t kingRookMoves = get_rook_attacks_magic(occupied, kingSquare);
+    uint64_t checkers = get_square_attackers(board->pieces, occupied, kingSquare, 1 - board->turn); // squares of all checking pieces
+
+    if (checkers) {
+        return get_evasions(board, checkers, kingBishopMoves, kingRookMoves, friendlyPieces, opponentPieces);
+    }
+
+    // 2. get king moves
+
+    occupied &= board->turn == White ? ~board->pieces[WhiteKing] : ~board->pieces[BlackKing]; // remove king
+
+    uint64_t directionalAttacks[8]; // attacks from each direction
+    uint64_t attacked = get_attacked_squares(board, occupied, directionalAttacks); // all attacked squares
 
     append_list(get_moves_from_uint64(kingSquare, kingAttacks[kingSquare] & ~attacked, friendlyPieces, opponentPieces), &moves, &tail);
 
     // king-side castle
-    if (board->castleKing[board->turn] && !((attacked | occupied) & (0x70LL << (56 * board->turn)))) {
+    if ((board->castling & CASTLE_KING(board->turn)) && !((attacked | occupied) & (0x70LL << (56 * board->turn)))) {
         append_list(cons(kingSquare | (kingSquare + 2) << 6 | 0x2000, NULL), &moves, &tail);
     } 
 
     // queen-side castle
-    if (board->castleQueen[board->turn] && !(occupied & (0x1eLL << (56 * board->turn))) && !(attacked & (0x1cLL << (56 * board->turn)))) {
-        append_list(cons(kingSquare | (kingSquare - 2) << 6 | 0x2000, NULL), &moves, &tail);
+    if ((board->castling & CASTLE_QUEEN(board->turn)) && !(occupied & (0x1eLL << (56 * board->turn))) && !(attacked & (0x1cLL << (56 * board->turn)))) {
+        append_list(cons(kingSquare | (kingSquare - 2) << 6 | 0x3000, NULL), &moves, &tail);
     }
 
     occupied |= board->turn == White ? board->pieces[WhiteKing] : board->pieces[BlackKing]; // add king back in
-    
-    // 2. handle check
 
-    uint64_t checkers; // squares of all checking pieces
+    uint64_t mask = 0xFFFFFFFFFFFFFFFFLL; // mask of allowable moves
 
-    // moves from king
-    uint64_t kingBishopMoves = get_bishop_attacks_magic(occupied, kingSquare);
-    uint64_t kingRookMoves = get_rook_attacks_magic(occupied, kingSquare);
-    uint64_t kingQueenMoves = kingBishopMoves | kingRookMoves;
-    uint64_t kingKnightMoves = knightAttacks[kingSquare];
-    uint64_t kingPawnMoves = board->turn == White ? pawnAttacks[kingSquare][White] : pawnAttacks[kingSquare][Black];
-
-    uint64_t bishopCheckers, rookCheckers, queenCheckers, knightCheckers, pawnCheckers;
+    uint64_t opponentStraightSliders = board->turn == White ? (board->pieces[BlackRook] | board->pieces[BlackQueen]) : (board->pieces[WhiteRook] | board->pieces[WhiteQueen]);
+    uint64_t opponentDiagonalSliders = board->turn == White ? (board->pieces[BlackBishop] | board->pieces[BlackQueen]) : (board->pieces[WhiteBishop] | board->pieces[WhiteQueen]);
 
-    if (board->turn == White) {
-        bishopCheckers = kingBishopMoves & board->pieces[BlackBishop];
-        rookCheckers = kingRookMoves & board->pieces[BlackRook];
-        queenCheckers = kingQueenMoves & board->pieces[BlackQueen];
-        knightCheckers = kingKnightMoves & board->pieces[BlackKnight];
-        pawnCheckers = kingPawnMoves & board->pieces[BlackPawn];
-    } else {
-        bishopCheckers = kingBishopMoves & board->pieces[WhiteBishop];
-        rookCheckers = kingRookMoves & board->pieces[WhiteRook];
-        queenCheckers = kingQueenMoves & board->pieces[WhiteQueen];
-        knightCheckers = kingKnightMoves & board->pieces[WhiteKnight];
-        pawnCheckers = kingPawnMoves & board->pieces[WhitePawn];
-    }
+    // 3. get moves for pinned pieces, which stay on the line through the king; pinned knights cannot move
 
-    checkers = bishopCheckers | rookCheckers | queenCheckers | knightCheckers | pawnCheckers;
-    int numCheckers = popCount(checkers); // number of checking pieces
+    uint64_t allPinnedPieces = get_pinned_pieces(occupied, friendlyPieces, kingSquare, kingBishopMoves, kingRookMoves, opponentDiagonalSliders, opponentStraightSliders);
+    int offset = board->turn == White ? 1 : 0;
 
-    if (numCheckers >= 2) {
-        return moves; // double check; only king moves
-    }
-
-    uint64_t pushMask = 0xFFFFFFFFFFFFFFFFLL; // mask of allowable moves
-    uint64_t captureMask = 0xFFFFFFFFFFFFFFFFLL; // mask of allowable captures
-
-    // single check
-    if (numCheckers == 1) {
-        captureMask = checkers;
-        if (bishopCheckers > 0) {
-            pushMask = emptyBishopAttacks[bitscan_forward(bishopCheckers)] & kingBishopMoves;
-        } else if (rookCheckers > 0) {
-            pushMask = emptyRookAttacks[bitscan_forward(rookCheckers)] & kingRookMoves;
-        } else if (queenCheckers > 0) {
-            if (emptyBishopAttacks[kingSquare] & queenCheckers) {
-                pushMask = emptyBishopAttacks[bitscan_forward(queenCheckers)] & kingBishopMoves;
-            } else {
-                pushMask = emptyRookAttacks[bitscan_forward(queenCheckers)] & kingRookMoves;
-            }
-        } else {
-            pushMask = 0LL;
-        }
-    }
-
-    // 3. get moves for pinned pieces
-    
-    uint64_t allPinnedPieces = 0;
-
-    for (int i = 1; i < 8; i += 2) {
-        shortlist* pinnedMoves = get_pinned_diagonal_moves(board, i, directionalAttacks, kingBishopMoves, kingSquare, friendlyPieces, opponentPieces, &allPinnedPieces);
-        append_list(pinnedMoves, &moves, &tail);
-    }
-    
-    for (int i = 0; i < 8; i += 2) {
-        shortlist* pinnedMoves = get_pinned_straight_moves(board, i, directionalAttacks, kingRookMoves, kingSquare, friendlyPieces, opponentPieces, &allPinnedPieces);
-        append_list(pinnedMoves, &moves, &tail);
+    for (uint64_t pinned = allPinnedPieces & ~board->pieces[BlackKnight + offset]; pinned; pinned &= pinned - 1) {
+        uint64_t pinnedPiece = pinned & -pinned;
+        uint64_t pinLine = lineThrough[kingSquare][bitscan_forward(pinned)];
+        append_list(get_all_bishop_moves(pinnedPiece & board->pieces[BlackBishop + offset], occupied, friendlyPieces, opponentPieces, pinLine), &moves, &tail);
+        append_list(get_all_rook_moves(pinnedPiece & board->pieces[BlackRook + offset], occupied, friendlyPieces, opponentPieces, pinLine), &moves, &tail);
+        append_list(get_all_queen_moves(pinnedPiece & board->pieces[BlackQueen + offset], occupied, friendlyPieces, opponentPieces, pinLine), &moves, &tail);
+        append_list(get_all_pawn_pushes(pinnedPiece & board->pieces[BlackPawn + offset], occupied, pinLine, board->turn), &moves, &tail);
+        append_list(get_all_pawn_captures(pinnedPiece & board->pieces[BlackPawn + offset], opponentPieces, pinLine, board->turn), &moves, &tail);
     }
 
     // 4. get moves for all other pieces
@@ -1047,264 +1520,619 @@ shortlist* get_all_moves(chessboard* board) {
         friendlyPawns = board->pieces[BlackPawn] & notPinned;
     }
 
-    append_list(get_all_bishop_moves(friendlyBishops, occupied, friendlyPieces, opponentPieces, pushMask | captureMask), &moves, &tail);
-    append_list(get_all_rook_moves(friendlyRooks, occupied, friendlyPieces, opponentPieces, pushMask | captureMask), &moves, &tail);
-    append_list(get_all_queen_moves(friendlyQueens, occupied, friendlyPieces, opponentPieces, pushMask | captureMask), &moves, &tail);
-    append_list(get_all_knight_moves(friendlyKnights, occupied, friendlyPieces, opponentPieces, pushMask | captureMask), &moves, &tail);
-    append_list(get_all_pawn_pushes(friendlyPawns, occupied, pushMask, board->turn), &moves, &tail);
-    append_list(get_all_pawn_captures(friendlyPawns, occupied, opponentPieces, captureMask, board->turn), &moves, &tail);
-    uint64_t opponentSliders = board->turn == White ? (board->pieces[BlackRook] | board->pieces[BlackQueen]) : (board->pieces[WhiteRook] | board->pieces[WhiteQueen]);
-    append_list(get_all_pawn_en_passant(friendlyPawns, occupied, opponentSliders, pushMask, captureMask, kingSquare, board->epSquare, board->turn), &moves, &tail);
+    append_list(get_all_bishop_moves(friendlyBishops, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_rook_moves(friendlyRooks, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_queen_moves(friendlyQueens, occupied, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_knight_moves(friendlyKnights, friendlyPieces, opponentPieces, mask), &moves, &tail);
+    append_list(get_all_pawn_pushes(friendlyPawns, occupied, mask, board->turn), &moves, &tail);
+    append_list(get_all_pawn_captures(friendlyPawns, opponentPieces, mask, board->turn), &moves, &tail);
+    uint64_t allPawns = board->turn == White ? board->pieces[WhitePawn] : board->pieces[BlackPawn]; // pins are checked directly
+    append_list(get_all_pawn_en_passant(allPawns, occupied, opponentStraightSliders, opponentDiagonalSliders, mask, mask, kingSquare, board->epSquare, board->turn), &moves, &tail);
 
     return moves;
 }
 
-void make_capture(chessboard* board, unsigned short square) {
-    unsigned short capturedPiece = get_board_piece(board, square);
-    board->pieces[capturedPiece] &= ~(1LL << square);
-    board->captureLogTail->val = capturedPiece;
-    board->halfMoveClock = 0;
+// get squares attacked by the opponent, checkers, pins and the legal destinations of each piece
+// of side turn from the generator's bitboards; targets may be NULL to only count moves
+int generate_targets(uint64_t* pieces, pieceColor turn, int castling, int epSquare, moveTargets* targets) {
+    int offset = turn == White ? 1 : 0; // pieces of side to move have this parity
+    uint64_t whitePieces = pieces[WhiteKing] | pieces[WhiteBishop] | pieces[WhiteRook] | pieces[WhiteQueen] | pieces[WhiteKnight] | pieces[WhitePawn];
+    uint64_t blackPieces = pieces[BlackKing] | pieces[BlackBishop] | pieces[BlackRook] | pieces[BlackQueen] | pieces[BlackKnight] | pieces[BlackPawn];
+    uint64_t friendlyPieces = turn == White ? whitePieces : blackPieces;
+    uint64_t opponentPieces = turn == White ? blackPieces : whitePieces;
+    uint64_t occupied = friendlyPieces | opponentPieces;
+    uint64_t king = pieces[BlackKing + offset];
+    int kingSquare = bitscan_forward(king);
+
+    // attacks through the king, so it cannot step back along a checking ray
+    uint64_t directionalAttacks[8];
+    uint64_t attacked = get_opponent_attacks(pieces, turn, occupied & ~king, directionalAttacks);
+
+    uint64_t kingBishopMoves = get_bishop_attacks_magic(occupied, kingSquare);
+    uint64_t kingRookMoves = get_rook_attacks_magic(occupied, kingSquare);
+    uint64_t opponentDiagonalSliders = pieces[WhiteBishop - offset] | pieces[WhiteQueen - offset];
+    uint64_t opponentStraightSliders = pieces[WhiteRook - offset] | pieces[WhiteQueen - offset];
+    uint64_t checkers = (kingBishopMoves & opponentDiagonalSliders) | (kingRookMoves & opponentStraightSliders) |
+        (knightAttacks[kingSquare] & pieces[WhiteKnight - offset]) | (pawnAttacks[kingSquare][turn] & pieces[WhitePawn - offset]);
+
+    // king moves and castling
+    uint64_t kingTargets = kingAttacks[kingSquare] & ~friendlyPieces & ~attacked;
+    uint64_t emptyOrKing = ~occupied | king;
+    if ((castling & CASTLE_KING(turn)) && !((attacked | ~emptyOrKing) & (0x70LL << (56 * turn)))) {
+        kingTargets |= 1LL << (kingSquare + 2);
+    }
+    if ((castling & CASTLE_QUEEN(turn)) && !(~emptyOrKing & (0x1eLL << (56 * turn))) && !(attacked & (0x1cLL << (56 * turn)))) {
+        kingTargets |= 1LL << (kingSquare - 2);
+    }
+    int numMoves = popCount(kingTargets);
+    uint64_t pinned = 0;
+    if (targets) {
+        memset(targets->targets, 0, sizeof(targets->targets));
+        targets->targets[kingSquare] = kingTargets;
+        targets->attacked = attacked;
+        targets->checkers = checkers;
+    }
+    if (checkers & (checkers - 1)) {
+        if (targets) {
+            targets->pinned = 0;
+            targets->numMoves = numMoves;
+        }
+        return numMoves;
+    }
+
+    // other pieces must capture a single checker or block its ray
+    uint64_t mask = checkers ? checkers | between[kingSquare][bitscan_forward(checkers)] : 0xFFFFFFFFFFFFFFFFLL;
+
+    // pinned pieces stay on the line through the king
+    pinned = get_pinned_pieces(occupied, friendlyPieces, kingSquare, kingBishopMoves, kingRookMoves, opponentDiagonalSliders, opponentStraightSliders);
+
+    uint64_t sliders[3] = {pieces[BlackBishop + offset], pieces[BlackRook + offset], pieces[BlackQueen + offset]};
+    for (int type = 0; type < 3; type ++) {
+        for (uint64_t bits = sliders[type]; bits; bits &= bits - 1) {
+            int square = bitscan_forward(bits);
+            uint64_t attacks = 0;
+            if (type != 1) {
+                attacks |= get_bishop_attacks_magic(occupied, square);
+            }
+            if (type != 0) {
+                attacks |= get_rook_attacks_magic(occupied, square);
+            }
+            uint64_t squareTargets = attacks & ~friendlyPieces & mask;
+            if ((pinned >> square) & 1) {
+                squareTargets &= lineThrough[kingSquare][square];
+            }
+            numMoves += popCount(squareTargets);
+            if (targets) {
+                targets->targets[square] = squareTargets;
+            }
+        }
+    }
+
+    // pinned knights cannot move
+    for (uint64_t bits = pieces[BlackKnight + offset] & ~pinned; bits; bits &= bits - 1) {
+        int square = bitscan_forward(bits);
+        uint64_t squareTargets = knightAttacks[square] & ~friendlyPieces & mask;
+        numMoves += popCount(squareTargets);
+        if (targets) {
+            targets->targets[square] = squareTargets;
+        }
+    }
+
+    // pawns: promotions count once for each piece
+    int f = turn == White ? 8 : -8;
+    uint64_t lastRank = 0xFFLL << (56 * (1 - turn));
+    uint64_t doubleRank = 0xFFLL << (turn == White ? 24 : 32);
+    int epTarget = epSquare >= 0 ? epSquare + f : -1;
+    for (uint64_t bits = pieces[BlackPawn + offset]; bits; bits &= bits - 1) {
+        int square = bitscan_forward(bits);
+        uint64_t single = (1LL << (square + f)) & ~occupied;
+        uint64_t squareTargets = single;
+        if (single) {
+            squareTargets |= (f > 0 ? single << 8 : single >> 8) & doubleRank & ~occupied;
+        }
+        squareTargets = (squareTargets | (pawnAttacks[square][turn] & opponentPieces)) & mask;
+        if ((pinned >> square) & 1) {
+            squareTargets &= lineThrough[kingSquare][square];
+        }
+        // en passant is checked by removing both pawns
+        if (epTarget >= 0 && ((pawnAttacks[square][turn] >> epTarget) & 1) && (((mask >> epSquare) & 1) || ((mask >> epTarget) & 1))) {
+            uint64_t after = (occupied & ~((1LL << square) | (1LL << epSquare))) | (1LL << epTarget);
+            if (!(get_rook_attacks_magic(after, kingSquare) & opponentStraightSliders) && !(get_bishop_attacks_magic(after, kingSquare) & opponentDiagonalSliders)) {
+                squareTargets |= 1LL << epTarget;
+            }
+        }
+        numMoves += popCount(squareTargets) + 3 * popCount(squareTargets & lastRank);
+        if (targets) {
+            targets->targets[square] = squareTargets;
+        }
+    }
+
+    if (targets) {
+        targets->pinned = pinned;
+        targets->numMoves = numMoves;
+    }
+    return numMoves;
 }
 
-void make_move(chessboard* board, unsigned short move) {
-    unsigned short startSquare = move & 0x3F;
-    unsigned short piece = get_board_piece(board, startSquare);
-    board->pieces[piece] &= ~(1LL << startSquare); // remove piece
-    move >>= 6;
-    unsigned short endSquare = move & 0x3F;
-    move >>= 6;
+// fill targets of side to move without building moves
+void get_move_targets(chessboard* board, moveTargets* targets) {
+    generate_targets(board->pieces, board->turn, board->castling, board->epSquare, targets);
+}
+
+// count legal moves of side to move without building them
+int count_moves(chessboard* board) {
+    return generate_targets(board->pieces, board->turn, board->castling, board->epSquare, NULL);
+}
 
-    // set log entries to default value
-    append_list(cons(-1, NULL), &board->captureLog, &board->captureLogTail); 
-    append_list(cons(board->castleKing[board->turn], NULL), &board->castleKingLog, &board->castleKingLogTail);
-    append_list(cons(board->castleQueen[board->turn], NULL), &board->castleQueenLog, &board->castleQueenLogTail);
-    append_list(cons(board->epSquare, NULL), &board->epLog, &board->epLogTail);
-    append_list(cons(board->halfMoveClock, NULL), &board->halfMoveClockLog, &board->halfMoveClockLogTail);
-
-    board->epSquare = -1; // reset en passant target
-    board->halfMoveClock ++; // add to half move clock
-
-    // remove castling rights
-    if (piece == White) {
-        if (piece == WhiteRook) {
-            if (startSquare == 0) {
-                board->castleQueen[White] = 0;
-            } else if (startSquare == 7) {
-                board->castleKing[White] = 0;
+// write the moves of targets filled for side turn to moves, which must hold targets->numMoves; returns their number
+int write_target_moves(uint64_t* pieces, pieceColor turn, moveTargets* targets, unsigned short* moves) {
+    int offset = turn == White ? 1 : 0;
+    uint64_t opponentPieces = 0;
+    for (int piece = 1 - offset; piece < 12; piece += 2) {
+        opponentPieces |= pieces[piece];
+    }
+    int numMoves = 0;
+    for (int piece = BlackPawn + offset; piece < 12; piece += 2) {
+        for (uint64_t bits = pieces[piece]; bits; bits &= bits - 1) {
+            int start = bitscan_forward(bits);
+            for (uint64_t ends = targets->targets[start]; ends; ends &= ends - 1) {
+                int end = bitscan_forward(ends);
+                int flag = (opponentPieces >> end) & 1 ? 4 : 0;
+                if (piece / 2 == 0) {
+                    if (abs(end - start) == 16) {
+                        flag = 1;
+                    } else if ((end - start) % 8 != 0 && !flag) {
+                        flag = 5;
+                    }
+                    if (end < 8 || end >= 56) {
+                        for (int promotion = 0; promotion < 4; promotion ++) {
+                            moves[numMoves ++] = start | end << 6 | (flag | 8 | promotion) << 12;
+                        }
+                        continue;
+                    }
+                } else if (piece / 2 == 5 && abs(end - start) == 2) {
+                    flag = end > start ? 2 : 3;
+                }
+                moves[numMoves ++] = start | end << 6 | flag << 12;
             }
-        } else if (piece == WhiteKing) {
-            board->castleQueen[White] = 0;
-            board->castleKing[White] = 0;
         }
-    } else {
-        if (piece == BlackRook) {
-            if (startSquare == 56) {
-                board->castleQueen[Black] = 0;
-            } else if (startSquare == 63) {
-                board->castleKing[Black] = 0;
+    }
+    return numMoves;
+}
+
+// write the moves of targets filled for board to moves, which must hold targets->numMoves; returns their number
+int get_target_moves(chessboard* board, moveTargets* targets, unsigned short* moves) {
+    return write_target_moves(board->pieces, board->turn, targets, moves);
+}
+
+// fill info for the side to move of board
+void get_check_info(chessboard* board, checkInfo* info) {
+    int offset = board->turn == White ? 1 : 0; // pieces of side to move have this parity
+    uint64_t* pieces = board->pieces;
+    info->friendlyPieces = 0;
+    info->opponentPieces = 0;
+    for (int piece = 0; piece < 12; piece += 2) {
+        info->friendlyPieces |= pieces[piece + offset];
+        info->opponentPieces |= pieces[piece + 1 - offset];
+    }
+    uint64_t occupied = info->friendlyPieces | info->opponentPieces;
+    info->kingSquare = bitscan_forward(pieces[BlackKing + offset]);
+    info->opponentKingSquare = bitscan_forward(pieces[WhiteKing - offset]);
+    uint64_t kingBishopMoves = get_bishop_attacks_magic(occupied, info->kingSquare);
+    uint64_t kingRookMoves = get_rook_attacks_magic(occupied, info->kingSquare);
+    info->checkers = get_square_attackers(pieces, occupied, info->kingSquare, 1 - board->turn);
+    info->pinned = get_pinned_pieces(occupied, info->friendlyPieces, info->kingSquare, kingBishopMoves, kingRookMoves,
+        pieces[WhiteBishop - offset] | pieces[WhiteQueen - offset], pieces[WhiteRook - offset] | pieces[WhiteQueen - offset]);
+
+    // own pieces in front of own sliders are pinned to the opponent king the same way
+    uint64_t opponentKingBishopMoves = get_bishop_attacks_magic(occupied, info->opponentKingSquare);
+    uint64_t opponentKingRookMoves = get_rook_attacks_magic(occupied, info->opponentKingSquare);
+    info->discoverers = get_pinned_pieces(occupied, info->friendlyPieces, info->opponentKingSquare, opponentKingBishopMoves, opponentKingRookMoves,
+        pieces[BlackBishop + offset] | pieces[BlackQueen + offset], pieces[BlackRook + offset] | pieces[BlackQueen + offset]);
+    info->checkSquares[0] = pawnAttacks[info->opponentKingSquare][1 - board->turn];
+    info->checkSquares[1] = knightAttacks[info->opponentKingSquare];
+    info->checkSquares[2] = opponentKingBishopMoves;
+    info->checkSquares[3] = opponentKingRookMoves;
+    info->checkSquares[4] = opponentKingBishopMoves | opponentKingRookMoves;
+    info->checkSquares[5] = 0;
+}
+
+// check if en passant capture of start leaves the king safe from sliders
+int is_en_passant_safe(chessboard* board, checkInfo* info, int start, int end) {
+    int offset = board->turn == White ? 1 : 0;
+    uint64_t occupied = info->friendlyPieces | info->opponentPieces;
+    uint64_t after = (occupied & ~((1LL << start) | (1LL << board->epSquare))) | (1LL << end);
+    return !(get_rook_attacks_magic(after, info->kingSquare) & (board->pieces[WhiteRook - offset] | board->pieces[WhiteQueen - offset])) &&
+        !(get_bishop_attacks_magic(after, info->kingSquare) & (board->pieces[WhiteBishop - offset] | board->pieces[WhiteQueen - offset]));
+}
+
+// check if any 16-bit move, such as a hash or killer move, is legal on board without generating moves
+int is_legal(chessboard* board, checkInfo* info, unsigned short move) {
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    uint64_t startBit = 1LL << start;
+    uint64_t endBit = 1LL << end;
+    if (!(info->friendlyPieces & startBit) || (info->friendlyPieces & endBit) || flag == 6 || flag == 7) {
+        return 0;
+    }
+    int offset = board->turn == White ? 1 : 0;
+    int type = 0;
+    while (!(board->pieces[2 * type + offset] & startBit)) {
+        type ++;
+    }
+    uint64_t occupied = info->friendlyPieces | info->opponentPieces;
+    int capture = flag == 4 || flag >= 12;
+    if (capture != ((info->opponentPieces & endBit) != 0) && flag != 5) {
+        return 0;
+    }
+
+    if (type == 5) {
+        if (flag == 2 || flag == 3) {
+            // castling from the initial squares through empty and safe squares
+            int kingSide = flag == 2;
+            uint64_t path = (kingSide ? 0x60LL : 0x0eLL) << (56 * board->turn);
+            uint64_t kingPath = (kingSide ? 0x70LL : 0x1cLL) << (56 * board->turn);
+            if (!(board->castling & (kingSide ? CASTLE_KING(board->turn) : CASTLE_QUEEN(board->turn))) || start != 4 + 56 * (int) board->turn ||
+                end != start + (kingSide ? 2 : -2) || (occupied & path)) {
+                return 0;
+            }
+            for (; kingPath; kingPath &= kingPath - 1) {
+                if (get_square_attackers(board->pieces, occupied, bitscan_forward(kingPath), 1 - board->turn)) {
+                    return 0;
+                }
             }
-        } else if (piece == BlackKing) {
-            board->castleQueen[Black] = 0;
-            board->castleKing[Black] = 0;
+            return 1;
         }
+        return flag <= 4 && flag != 1 && (kingAttacks[start] & endBit) &&
+            !get_square_attackers(board->pieces, occupied & ~startBit, end, 1 - board->turn);
+    }
+    if (info->checkers & (info->checkers - 1)) {
+        return 0; // double check; only king moves
     }
 
-    // handle flag
-    switch (move) {
-        case 0:
-            break;
-        case 1:
-            board->epSquare = endSquare;
-            break;
-        case 2:
-            if (board->turn == White) {
-                board->pieces[WhiteRook] &= ~1LL;
-                board->pieces[WhiteRook] |= 8LL;
-            } else {
-                board->pieces[BlackRook] &= ~0x100000000000000LL;
-                board->pieces[BlackRook] |= 0x800000000000000LL;
+    uint64_t lastRank = 0xFFLL << (56 * (1 - board->turn));
+    if (type == 0) {
+        int f = board->turn == White ? 8 : -8;
+        if (((flag & 8) != 0) != ((lastRank & endBit) != 0) || flag == 2 || flag == 3) {
+            return 0; // pawns promote exactly on the last rank
+        }
+        if (flag == 5) {
+            if (board->epSquare < 0 || end != board->epSquare + f || !(pawnAttacks[start][board->turn] & endBit)) {
+                return 0;
             }
-            break;
-        case 3:
-            if (board->turn == White) {
-                board->pieces[WhiteRook] &= ~0x80LL;
-                board->pieces[WhiteRook] |= 0x10LL;
-            } else {
-                board->pieces[BlackRook] &= ~0x8000000000000000LL;
-                board->pieces[BlackRook] |= 0x1000000000000000LL;
+            // the captured pawn may be the checker, or the pawn may block a slider
+            if (info->checkers && !(info->checkers & (1LL << board->epSquare)) && !(between[info->kingSquare][bitscan_forward(info->checkers)] & endBit)) {
+                return 0;
             }
-            break;
-        case 4: 
-            make_capture(board, endSquare);
-            break;
-        case 5: 
-            make_capture(board, board->turn == White ? endSquare - 8 : endSquare + 8);
-            break;
-        case 8:
-            board->pieces[board->turn == White ? WhiteKnight : BlackKnight] |= 1LL << endSquare;
-            break;
-        case 9:
-            board->pieces[board->turn == White ? WhiteBishop : BlackBishop] |= 1LL << endSquare;
-            break;
-        case 10:
-            board->pieces[board->turn == White ? WhiteRook : BlackRook] |= 1LL << endSquare;
-            break;
-        case 11:
-            board->pieces[board->turn == White ? WhiteQueen : BlackQueen] |= 1LL << endSquare;
-            break;
-        case 12: 
-            make_capture(board, endSquare);
-            board->pieces[board->turn == White ? WhiteKnight : BlackKnight] |= 1LL << endSquare;
-            break;
-        case 13:
-            make_capture(board, endSquare);
-            board->pieces[board->turn == White ? WhiteBishop : BlackBishop] |= 1LL << endSquare;
-            break;
-        case 14:
-            make_capture(board, endSquare);
-            board->pieces[board->turn == White ? WhiteRook : BlackRook] |= 1LL << endSquare;
-            break;
-        case 15:
-            make_capture(board, endSquare);
-            board->pieces[board->turn == White ? WhiteQueen : BlackQueen] |= 1LL << endSquare;
+            return is_en_passant_safe(board, info, start, end);
+        } else if (flag == 1) {
+            uint64_t doubleRank = 0xFFLL << (board->turn == White ? 24 : 32);
+            if (end != start + 2 * f || !(doubleRank & endBit) || (occupied & (1LL << (start + f))) || (occupied & endBit)) {
+                return 0;
+            }
+        } else if (capture) {
+            if (!(pawnAttacks[start][board->turn] & endBit)) {
+                return 0;
+            }
+        } else if (end != start + f || (occupied & endBit)) {
+            return 0;
+        }
+    } else {
+        uint64_t attacks = type == 1 ? knightAttacks[start] : 0;
+        if (type == 2 || type == 4) {
+            attacks |= get_bishop_attacks_magic(occupied, start);
+        }
+        if (type == 3 || type == 4) {
+            attacks |= get_rook_attacks_magic(occupied, start);
+        }
+        if ((flag != 0 && flag != 4) || !(attacks & endBit)) {
+            return 0;
+        }
     }
-    
-    // place piece
-    if (move < 8) {
-        board->pieces[piece] |= 1LL << endSquare;
+
+    // single checks must be captured or blocked, and pinned pieces stay on their line
+    if (info->checkers && !((info->checkers | between[info->kingSquare][bitscan_forward(info->checkers)]) & endBit)) {
+        return 0;
     }
-    
-    if (piece == WhitePawn || piece == BlackPawn) {
-        board->halfMoveClock = 0;
+    return !(info->pinned & startBit) || (lineThrough[info->kingSquare][start] & endBit);
+}
+
+// check if legal move gives check without making it
+int gives_check(chessboard* board, checkInfo* info, unsigned short move) {
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    uint64_t startBit = 1LL << start;
+    uint64_t endBit = 1LL << end;
+    int offset = board->turn == White ? 1 : 0;
+    int type = 0;
+    while (!(board->pieces[2 * type + offset] & startBit)) {
+        type ++;
+    }
+    uint64_t occupied = info->friendlyPieces | info->opponentPieces;
+
+    if ((info->discoverers & startBit) && !(lineThrough[info->opponentKingSquare][start] & endBit)) {
+        return 1;
+    }
+
+    uint64_t after = (occupied & ~startBit) | endBit;
+    uint64_t diagonalSliders = board->pieces[BlackBishop + offset] | board->pieces[BlackQueen + offset];
+    uint64_t straightSliders = board->pieces[BlackRook + offset] | board->pieces[BlackQueen + offset];
+    if (flag & 8) {
+        // the promoted piece attacks through the square the pawn left
+        int promoted = 1 + (flag & 3);
+        uint64_t attacks = promoted == 1 ? knightAttacks[end] : 0;
+        if (promoted == 2 || promoted == 4) {
+            attacks |= get_bishop_attacks_magic(after, end);
+        }
+        if (promoted == 3 || promoted == 4) {
+            attacks |= get_rook_attacks_magic(after, end);
+        }
+        return (attacks >> info->opponentKingSquare) & 1;
+    } else if (info->checkSquares[type] & endBit) {
+        return 1;
+    } else if (flag == 5) {
+        // both pawns leave their squares
+        after &= ~(1LL << board->epSquare);
+        return ((get_bishop_attacks_magic(after, info->opponentKingSquare) & diagonalSliders) |
+            (get_rook_attacks_magic(after, info->opponentKingSquare) & straightSliders)) != 0;
+    } else if (flag == 2 || flag == 3) {
+        int rookEnd = flag == 2 ? end - 1 : end + 1;
+        int rookStart = flag == 2 ? end + 1 : end - 2;
+        after = (occupied & ~(startBit | (1LL << rookStart))) | endBit | (1LL << rookEnd);
+        return (get_rook_attacks_magic(after, rookEnd) >> info->opponentKingSquare) & 1;
     }
+    return 0;
+}
 
-    if (board->turn == Black) {
-        board->fullMoves ++; // update full move count
+// place piece on square and update evaluation
+void add_piece(chessboard* board, int piece, int square) {
+    board->pieces[piece] |= 1LL << square;
+    board->key ^= zobristPieces[piece][square];
+    if (piece <= WhitePawn) {
+        board->pawnKey ^= zobristPieces[piece][square];
+    }
+    board->mgScore += mgTable[piece][square];
+    board->egScore += egTable[piece][square];
+    board->phase += phaseValues[piece];
+    if (board->accumulator) {
+        nnue_add_feature(board->accumulator, piece, square);
     }
+}
+
+// remove piece from square and update evaluation
+void remove_piece(chessboard* board, int piece, int square) {
+    board->pieces[piece] &= ~(1LL << square);
+    board->key ^= zobristPieces[piece][square];
+    if (piece <= WhitePawn) {
+        board->pawnKey ^= zobristPieces[piece][square];
+    }
+    board->mgScore -= mgTable[piece][square];
+    board->egScore -= egTable[piece][square];
+    board->phase -= phaseValues[piece];
+    if (board->accumulator) {
+        nnue_remove_feature(board->accumulator, piece, square);
+    }
+}
+
+// castling rights lost by moving from or capturing on each square
+uint8_t castlingLoss[64] = {[a1] = 2, [e1] = 3, [h1] = 1, [a8] = 8, [e8] = 12, [h8] = 4};
+
+// rook squares of king-side and queen-side castling for each side, by flag - 2 and turn
+int castleRookStart[2][2] = {{h1, h8}, {a1, a8}};
+int castleRookEnd[2][2] = {{f1, f8}, {d1, d8}};
+
+// black piece of each promotion flag & 3; the side to move adds its offset
+int promotionPieces[4] = {BlackKnight, BlackBishop, BlackRook, BlackQueen};
+
+// square of the pawn taken en passant relative to the end square, by turn
+int epCaptureOffset[2] = {-8, 8};
+
+// get piece of side with pieces at parity offset on square
+int get_side_piece(chessboard* board, int offset, int square) {
+    int piece = offset;
+    while (piece < 12 && !((board->pieces[piece] >> square) & 1)) {
+        piece += 2;
+    }
+    return piece < 12 ? piece : 13;
+}
 
+// push the state before a move, growing the stack when it is full
+boardState* push_state(chessboard* board) {
+    if (board->numStates == board->maxStates) {
+        int maxStates = board->maxStates ? 2 * board->maxStates : 256;
+        boardState* states = (boardState*) realloc(board->states, sizeof(boardState) * maxStates);
+        if (!states) {
+            // the old stack is still valid and freed by free_board_states, but the move cannot be made
+            fprintf(stderr, "out of memory for %d move states\n", maxStates);
+            abort();
+        }
+        board->states = states;
+        board->maxStates = maxStates;
+    }
+    boardState* state = &board->states[board->numStates ++];
+    state->key = board->key;
+    state->halfMoveClock = board->halfMoveClock;
+    state->epSquare = board->epSquare;
+    state->castlingRights = board->castling;
+    state->capturedPiece = 13;
+    return state;
+}
+
+void make_move(chessboard* board, unsigned short move) {
+    boardState* state = push_state(board);
+    int startSquare = move & 0x3F;
+    int endSquare = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    int offset = board->turn == White ? 1 : 0; // pieces of side to move have this parity
+    int piece = get_side_piece(board, offset, startSquare);
+    board->key ^= get_state_key(board); // state keys are replaced after the move
+
+    board->castling &= ~(castlingLoss[startSquare] | castlingLoss[endSquare]);
+    board->epSquare = flag == 1 ? endSquare : -1;
+    board->halfMoveClock = piece / 2 == 0 || (flag & 4) ? 0 : board->halfMoveClock + 1;
+
+    // captures, en passant and promotion captures have bit 2 of the flag set
+    if (flag & 4) {
+        int captureSquare = flag == 5 ? endSquare + epCaptureOffset[board->turn] : endSquare;
+        int capturedPiece = get_side_piece(board, 1 - offset, captureSquare);
+        remove_piece(board, capturedPiece, captureSquare);
+        state->capturedPiece = capturedPiece;
+    }
+    remove_piece(board, piece, startSquare);
+    add_piece(board, flag & 8 ? promotionPieces[flag & 3] + offset : piece, endSquare);
+    if (flag == 2 || flag == 3) {
+        remove_piece(board, BlackRook + offset, castleRookStart[flag - 2][board->turn]);
+        add_piece(board, BlackRook + offset, castleRookEnd[flag - 2][board->turn]);
+    }
+
+    board->fullMoves += board->turn; // update full move count after black moves
     board->turn = 1 - board->turn; // change turn
+    board->key ^= get_state_key(board);
+
+#ifdef DEBUG
+    verify_eval(board);
+#endif
 }
 
 void undo_move(chessboard* board, unsigned short move) {
-    int halfMoveNum = (board->fullMoves - 1) * 2 + board->turn;
-
-    if (halfMoveNum == 0) {
-        return;
+    if (!board->numStates) {
+        return; // no move to undo
     }
+    boardState* state = &board->states[-- board->numStates];
 
-    unsigned short startSquare = move & 0x3F;
-    move >>= 6;
-    unsigned short endSquare = move & 0x3F;
-    unsigned short piece = get_board_piece(board, endSquare);
-    board->pieces[piece] &= ~(1LL << endSquare); // remove piece
-    move >>= 6;
+    int startSquare = move & 0x3F;
+    int endSquare = (move >> 6) & 0x3F;
+    int flag = move >> 12;
 
     board->turn = 1 - board->turn;
-    
+    int offset = board->turn == White ? 1 : 0;
+
+    int piece = get_side_piece(board, offset, endSquare);
+    remove_piece(board, piece, endSquare);
+    add_piece(board, flag & 8 ? BlackPawn + offset : piece, startSquare);
+
     // uncapture
-    unsigned short capturedPiece = board->captureLogTail->val;
-    if (capturedPiece < 13) {
-        if (move == 5) {
-            board->pieces[capturedPiece] |= 1LL << (endSquare - 8 + 16 * board->turn);
-        } else {
-            board->pieces[capturedPiece] |= 1LL << endSquare;
-        }
+    if (state->capturedPiece < 13) {
+        add_piece(board, state->capturedPiece, flag == 5 ? endSquare + epCaptureOffset[board->turn] : endSquare);
     }
-    
-    if (move == 2) {
-        // king castle
-        if (board->turn == White) {
-            board->pieces[WhiteRook] &= ~8LL;
-            board->pieces[WhiteRook] |= 1LL;
-        } else {
-            board->pieces[BlackRook] &= ~0x800000000000000LL;
-            board->pieces[BlackRook] |= 0x100000000000000LL;
-        }
-    } else if (move == 3) {
-        // queen castle
-        if (board->turn == White) {
-            board->pieces[WhiteRook] &= ~0x10LL;
-            board->pieces[WhiteRook] |= 0x80LL;
-        } else {
-            board->pieces[BlackRook] &= ~0x1000000000000000LL;
-            board->pieces[BlackRook] |= 0x8000000000000000LL;
+    if (flag == 2 || flag == 3) {
+        remove_piece(board, BlackRook + offset, castleRookEnd[flag - 2][board->turn]);
+        add_piece(board, BlackRook + offset, castleRookStart[flag - 2][board->turn]);
+    }
+
+    // restore state
+    board->castling = state->castlingRights;
+    board->epSquare = state->epSquare;
+    board->halfMoveClock = state->halfMoveClock;
+    board->fullMoves -= board->turn;
+    board->key = state->key;
+
+#ifdef DEBUG
+    verify_eval(board);
+#endif
+}
+
+// pass turn to opponent
+void make_null_move(chessboard* board) {
+    push_state(board);
+    // repetitions are not searched across the null move
+    board->halfMoveClock = 0;
+    board->key ^= get_state_key(board);
+    board->epSquare = -1;
+    board->turn = 1 - board->turn;
+    board->key ^= get_state_key(board);
+}
+
+void undo_null_move(chessboard* board) {
+    boardState* state = &board->states[-- board->numStates];
+    board->turn = 1 - board->turn;
+    board->epSquare = state->epSquare;
+    board->halfMoveClock = state->halfMoveClock;
+    board->key = state->key;
+}
+
+// check if position occurred count times before since the last capture, pawn move or null move
+int is_repetition(chessboard* board, int count) {
+    // only positions an even number of plies back have the same side to move
+    for (int ply = 2; ply <= board->halfMoveClock && ply <= board->numStates; ply += 2) {
+        if (board->states[board->numStates - ply].key == board->key && -- count == 0) {
+            return 1;
         }
-    } else if (move >= 8) {
-        // promotion
-        piece = board ->turn == White ? WhitePawn : BlackPawn;
     }
-    
-    board->pieces[piece] |= 1LL << startSquare; // place piece
+    return 0;
+}
 
-    // update rights
-    board->castleKing[board->turn] = board->castleKingLogTail->val;
-    board->castleQueen[board->turn] = board->castleQueenLogTail->val;
-    board->epSquare = board->epLogTail->val;
-    board->halfMoveClock = board->halfMoveClockLogTail->val;
-    if (board->turn == Black) {
-        board->fullMoves --;
+// check if fifty moves passed without capture or pawn move, unless side to move is mated
+int is_fifty_move_draw(chessboard* board) {
+    if (board->halfMoveClock < 100) {
+        return 0;
     }
-    
-    // remove last log entries
-    if (halfMoveNum == 1) {
-        board->captureLog = NULL;
-        board->captureLogTail = NULL;
-        board->castleKingLog = NULL;
-        board->castleKingLogTail = NULL;
-        board->castleQueenLog = NULL;
-        board->castleQueenLogTail = NULL;
-        board->epLog = NULL;
-        board->epLogTail = NULL;
-        board->halfMoveClockLog = NULL;
-        board->halfMoveClockLogTail = NULL;
-    } else {
-        board->captureLogTail = get_item(board->captureLog, halfMoveNum - 2);
-        board->castleKingLogTail = get_item(board->castleKingLog, halfMoveNum - 2);
-        board->castleQueenLogTail = get_item(board->castleQueenLog, halfMoveNum - 2);
-        board->epLogTail = get_item(board->epLog, halfMoveNum - 2);
-        board->halfMoveClockLogTail = get_item(board->halfMoveClockLog, halfMoveNum - 2);
+    if (!in_check(board)) {
+        return 1;
     }
+    shortlist* moves = get_all_moves(board);
+    free_list(moves);
+    return moves != NULL;
 }
 
-int perft(chessboard* board, int depth) {
-    if (depth == 0) {
-        return 1LL;
+// check if neither side has material to mate: lone kings with at most one knight, or only bishops on one square color
+int is_insufficient_material(chessboard* board) {
+    uint64_t* pieces = board->pieces;
+    if (pieces[WhitePawn] | pieces[BlackPawn] | pieces[WhiteRook] | pieces[BlackRook] | pieces[WhiteQueen] | pieces[BlackQueen]) {
+        return 0;
     }
-    int nodes = 0;
-    shortlist* moves = get_all_moves(board);
-    shortlist* tail = moves;
-    while (tail) {
-        make_move(board, tail->val);
+    uint64_t knights = pieces[WhiteKnight] | pieces[BlackKnight];
+    uint64_t bishops = pieces[WhiteBishop] | pieces[BlackBishop];
+    if (!bishops) {
+        return popCount(knights) <= 1;
+    }
+    uint64_t lightSquares = 0x55AA55AA55AA55AAULL;
+    return !knights && (!(bishops & lightSquares) || !(bishops & ~lightSquares));
+}
+
+// check for any draw; the position must occur repetitions times before to be drawn by repetition
+int is_draw(chessboard* board, int repetitions) {
+    return is_repetition(board, repetitions) || is_insufficient_material(board) || is_fifty_move_draw(board);
+}
+
+// count leaf nodes of legal move tree; the last ply is counted without playing its moves
+uint64_t perft(chessboard* board, int depth) {
+    if (depth == 0) {
+        return 1;
+    } else if (depth == 1) {
+        return count_moves(board);
+    }
+    uint64_t nodes = 0;
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+    for (int i = 0; i < numMoves; i ++) {
+        make_move(board, moves[i]);
         nodes += perft(board, depth - 1);
-        undo_move(board, tail->val);
-        tail = tail->next;
+        undo_move(board, moves[i]);
     }
+    free(moves);
     return nodes;
 }
 
-int setup() {
+pthread_once_t setupOnce = PTHREAD_ONCE_INIT;
+
+void setup_tables() {
     setup_ms1b_table();
     setup_ray_attacks();
+    setup_line_tables();
     setup_piece_attacks();
+#ifndef NO_MAGICS
     setup_magics();
     setup_attack_table();
-    srand(3);
-    return 0;
+#endif
+    setup_eval_tables();
+    setup_zobrist();
 }
 
-int main(int argc, char* argv[]) {
-    setup();
-    chessboard board = new_board("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 0 1");
-    shortlist* moves = get_all_moves(&board);
-    print_board(&board);
-    printf("\n");
-    unsigned short move = get_item(moves, 8)->val;
-    make_move(&board, move);
-    print_board(&board);
-    moves = get_all_moves(&board);
-    shortlist* temp = moves;
-    while (temp) {
-        printf("%s\n", move_to_string(temp->val));
-        temp = temp->next;
-    }
+// fill the shared tables on the first call; safe to call from any thread
+int setup() {
+    pthread_once(&setupOnce, setup_tables);
+    return 0;
 }
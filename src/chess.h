@@ -0,0 +1,310 @@
+#ifndef CHESS
+#define CHESS
+
+#include <stdint.h>
+#include <stddef.h>
+#include "shortlist.h"
+
+typedef enum pieceColor pieceColor;
+
+enum pieceColor {
+    White, Black
+};
+
+typedef enum enumPiece enumPiece;
+
+enum enumPiece {
+    BlackPawn, WhitePawn, BlackKnight, WhiteKnight, BlackBishop, WhiteBishop, BlackRook, WhiteRook, BlackQueen, WhiteQueen, BlackKing, WhiteKing
+};
+
+typedef enum enumSquare enumSquare;
+
+enum enumSquare {
+    a1, b1, c1, d1, e1, f1, g1, h1,
+    a2, b2, c2, d2, e2, f2, g2, h2,
+    a3, b3, c3, d3, e3, f3, g3, h3,
+    a4, b4, c4, d4, e4, f4, g4, h4,
+    a5, b5, c5, d5, e5, f5, g5, h5,
+    a6, b6, c6, d6, e6, f6, g6, h6,
+    a7, b7, c7, d7, e7, f7, g7, h7,
+    a8, b8, c8, d8, e8, f8, g8, h8
+};
+
+typedef enum enumDirection enumDirection;
+
+enum enumDirection {
+    Nort, NoEa, East, SoEa, Sout, SoWe, West, NoWe
+};
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define MAX_FEN_LENGTH 128
+#define MAX_BENCH_POSITIONS 200000 // positions a bench loads, so the boards stay in memory
+
+// castling rights bits of side turn in chessboard.castling
+#define CASTLE_KING(turn) (1 << (2 * (turn)))
+#define CASTLE_QUEEN(turn) (2 << (2 * (turn)))
+
+typedef enum fenError fenError;
+
+enum fenError {
+    FenOk, FenMissingField, FenBadPiece, FenBadRank, FenBadSide, FenBadCastling, FenBadEnPassant, FenBadClock, FenBadKings, FenBadPawns, FenOpponentInCheck
+};
+
+typedef struct boardState boardState;
+
+// state before a move that cannot be recomputed from the move itself
+struct boardState {
+    uint64_t key; // zobrist key, also for repetition detection
+    int halfMoveClock;
+    signed char epSquare;
+    unsigned char castlingRights;
+    unsigned char capturedPiece; // 13 if nothing was captured
+};
+
+typedef struct board chessboard;
+
+struct board {
+    uint64_t pieces[12];
+    pieceColor turn;
+    unsigned char castling; // white king side, white queen side, black king side, black queen side from bit 0
+    int epSquare;
+    int halfMoveClock;
+    int fullMoves;
+    int mgScore; // midgame material and piece-square score (white - black)
+    int egScore; // endgame material and piece-square score (white - black)
+    int phase; // game phase from remaining material (24 = opening)
+    uint64_t key; // zobrist key of position
+    uint64_t pawnKey; // zobrist key of pawn structure
+    struct nnueAccumulator* accumulator; // first nnue layer, NULL when not in use
+    // stack of state before each move, allocated on the first move and freed by free_board_states
+    boardState* states;
+    int numStates;
+    int maxStates;
+};
+
+// attacks from each square in each direction on empty board
+extern uint64_t rayAttacks[64][8];
+
+// squares strictly between two squares on a line, and the whole line through them; empty if not on a line
+extern uint64_t between[64][64];
+extern uint64_t lineThrough[64][64];
+
+// attacks for sliding pieces from each square on empty board
+extern uint64_t emptyRookAttacks[64];
+extern uint64_t emptyBishopAttacks[64];
+extern uint64_t emptyQueenAttacks[64];
+
+// attacks for non-sliding pieces from each square
+extern uint64_t knightAttacks[64];
+extern uint64_t pawnAttacks[64][2];
+extern uint64_t kingAttacks[64];
+
+// random keys for each piece on each square
+extern uint64_t zobristPieces[12][64];
+extern uint64_t zobristCastling[4]; // white king, white queen, black king, black queen side
+extern uint64_t zobristEp[8]; // file of en passant pawn
+extern uint64_t zobristTurn; // black to move
+extern uint64_t castlingKeys[16]; // xor of the castling keys of each set of rights
+
+// castling rights lost by moving from or capturing on each square
+extern uint8_t castlingLoss[64];
+
+// rook squares of king-side and queen-side castling for each side, by flag - 2 and turn
+extern int castleRookStart[2][2];
+extern int castleRookEnd[2][2];
+
+// black piece of each promotion flag & 3; the side to move adds its offset
+extern int promotionPieces[4];
+
+void print_bitboard(uint64_t bitboard);
+
+const char* fen_error_string(fenError error);
+
+// parse and validate fen or the first four fields of an epd line into board
+// clocks are optional; if endPtr is given it is set to the first character after the fields read
+fenError parse_fen(char* fen, chessboard* board, char** endPtr);
+
+// check that kings, pawns, castling rights and en passant square are possible
+fenError validate_board(chessboard* board);
+
+// set empty state stack, keys and evaluation of board from its pieces and state
+void init_board(chessboard* board);
+
+// get board from fen; prints the error and returns the starting position if it is invalid
+chessboard new_board(char* fen);
+
+// parse the valid lines of an fen or epd file into a new array of at most maxPositions boards, freed by the caller;
+// returns their number, or -1 after printing the error if the file cannot be read or the array cannot be allocated
+int load_positions(char* path, chessboard** boards, int maxPositions);
+
+// write fen of board to str, which needs MAX_FEN_LENGTH characters; returns its length
+int board_to_fen(chessboard* board, char* str);
+
+// shift bitboard east one
+uint64_t east_one(uint64_t bitboard);
+
+// shift bitboard west one
+uint64_t west_one(uint64_t bitboard);
+
+// get zobrist key of pawn structure
+uint64_t get_pawn_key(chessboard* board);
+
+// get zobrist key of position
+uint64_t get_key(chessboard* board);
+
+// check if a pawn of side turn can capture the pawn that moved two squares to epSquare; the en passant
+// file is only part of the key then, so positions that differ only in an unusable en passant square repeat
+int can_capture_en_passant(uint64_t* pieces, pieceColor turn, int epSquare);
+
+// free state stack of moves made on board
+void free_board_states(chessboard* board);
+
+// copy board with its own state stack, so moves can be made on both
+void copy_board(chessboard* copy, chessboard* board);
+
+// get piece at square on chess board
+unsigned short get_board_piece(chessboard* board, unsigned short square);
+
+// print chess board
+void print_board(chessboard* board);
+
+// get bishop attack bitboard given blockers; built with -DNO_MAGICS, it uses obstruction difference
+// instead of the magic attack table
+uint64_t get_bishop_attacks_magic(uint64_t occupied, int square);
+
+// get rook attack bitboard given blockers; obstruction difference when built with -DNO_MAGICS
+uint64_t get_rook_attacks_magic(uint64_t occupied, int square);
+
+// get bishop attack bitboard given blockers from rayAttacks alone
+uint64_t get_bishop_attacks_obstruction(uint64_t occupied, int square);
+
+// get rook attack bitboard given blockers from rayAttacks alone
+uint64_t get_rook_attacks_obstruction(uint64_t occupied, int square);
+
+// get bishop attack bitboard given blockers by scanning each ray to its first blocker
+uint64_t get_bishop_attacks_classical(uint64_t occupied, int square);
+
+// get rook attack bitboard given blockers by scanning each ray to its first blocker
+uint64_t get_rook_attacks_classical(uint64_t occupied, int square);
+
+// bytes of tables used by the slider backend of the build
+size_t get_slider_table_size();
+
+// name of the slider backend of the build
+char* get_slider_backend();
+
+// get attacks of the sliders of one side in each direction from the attacks of each piece
+void get_directional_attacks_lookup(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied, uint64_t* attacks);
+
+// get attacks of the sliders of one side in each direction by kogge-stone fills
+void get_directional_attacks_fill(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupied, uint64_t* attacks);
+
+// convert move to string
+char* move_to_string(int move);
+
+// write move in long algebraic notation used by uci (e.g. e7e8q)
+void move_to_uci(unsigned short move, char* str);
+
+// get legal move written in long algebraic notation, or 0 if there is none
+unsigned short uci_to_move(chessboard* board, char* str);
+
+// get pieces of side attacking square on occupied board
+uint64_t get_square_attackers(uint64_t* pieces, uint64_t occupied, int square, pieceColor side);
+
+// check if square is attacked by pieces of side
+int is_square_attacked(chessboard* board, int square, pieceColor side);
+
+// check if king of side to move is attacked
+int in_check(chessboard* board);
+
+// get friendly pieces pinned to the king, found by x-ray attacks from the king through the first friendly blockers
+uint64_t get_pinned_pieces(uint64_t occupied, uint64_t friendlyPieces, int kingSquare, uint64_t kingBishopMoves, uint64_t kingRookMoves, uint64_t opponentDiagonalSliders, uint64_t opponentStraightSliders);
+
+// get list of all legal moves for side to move; positions in check go to get_evasions
+shortlist* get_all_moves(chessboard* board);
+
+// get list of legal moves out of check given the checkers and the attacks of a bishop and rook on the king's square
+shortlist* get_evasions(chessboard* board, uint64_t checkers, uint64_t kingBishopMoves, uint64_t kingRookMoves, uint64_t friendlyPieces, uint64_t opponentPieces);
+
+typedef struct moveTargets moveTargets;
+
+// bitboards of the legal move generator for the side to move
+struct moveTargets {
+    uint64_t attacked; // squares attacked by the opponent, seen through the king
+    uint64_t checkers; // opponent pieces giving check
+    uint64_t pinned; // pieces pinned to their king
+    uint64_t targets[64]; // legal destinations of the piece on each square, castling included for the king
+    int numMoves; // legal moves, with a move for each promotion piece
+};
+
+typedef struct checkInfo checkInfo;
+
+// state of the side to move for testing single moves
+struct checkInfo {
+    uint64_t friendlyPieces;
+    uint64_t opponentPieces;
+    uint64_t checkers; // opponent pieces giving check
+    uint64_t pinned; // pieces pinned to their king
+    uint64_t discoverers; // pieces blocking a slider from the opponent king
+    uint64_t checkSquares[6]; // squares from which each piece type gives check, by piece / 2
+    int kingSquare;
+    int opponentKingSquare;
+};
+
+// fill info for the side to move of board
+void get_check_info(chessboard* board, checkInfo* info);
+
+// check if any 16-bit move, such as a hash or killer move, is legal on board without generating moves
+int is_legal(chessboard* board, checkInfo* info, unsigned short move);
+
+// check if legal move gives check without making it
+int gives_check(chessboard* board, checkInfo* info, unsigned short move);
+
+// get squares attacked by the opponent, checkers, pins and the legal destinations of each piece
+// of side turn from the generator's bitboards; targets may be NULL to only count moves
+int generate_targets(uint64_t* pieces, pieceColor turn, int castling, int epSquare, moveTargets* targets);
+
+// write the moves of targets filled for side turn to moves, which must hold targets->numMoves; returns their number
+int write_target_moves(uint64_t* pieces, pieceColor turn, moveTargets* targets, unsigned short* moves);
+
+// get the squares attacked by the opponent of turn and get directional attacks
+uint64_t get_opponent_attacks(uint64_t* pieces, pieceColor turn, uint64_t occupied, uint64_t* directionalAttacks);
+
+// fill targets of side to move without building moves
+void get_move_targets(chessboard* board, moveTargets* targets);
+
+// count legal moves of side to move without building them
+int count_moves(chessboard* board);
+
+// write the moves of targets filled for board to moves, which must hold targets->numMoves; returns their number
+int get_target_moves(chessboard* board, moveTargets* targets, unsigned short* moves);
+
+void make_move(chessboard* board, unsigned short move);
+
+void undo_move(chessboard* board, unsigned short move);
+
+// check if position occurred count times before since the last capture, pawn move or null move
+int is_repetition(chessboard* board, int count);
+
+// check if fifty moves passed without capture or pawn move, unless side to move is mated
+int is_fifty_move_draw(chessboard* board);
+
+// check if neither side has material to mate: lone kings with at most one knight, or only bishops on one square color
+int is_insufficient_material(chessboard* board);
+
+// check for any draw; the position must occur repetitions times before to be drawn by repetition
+int is_draw(chessboard* board, int repetitions);
+
+// pass turn to opponent
+void make_null_move(chessboard* board);
+
+void undo_null_move(chessboard* board);
+
+// count leaf nodes of legal move tree
+uint64_t perft(chessboard* board, int depth);
+
+// fill the attack, evaluation and zobrist tables once; the tables are only read afterwards,
+// so boards and searches on different threads need no other shared state
+int setup();
+
+#endif
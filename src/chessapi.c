@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+#include "chess.h"
+#include "compact.h"
+#include "pack.h"
+#include "chessapi.h"
+
+// unpack into board; the tables are set up on the first call from any thread
+int load_position(const packedPosition* position, chessboard* board) {
+    setup();
+    packedPosition copy = *position;
+    return unpack_position(&copy, board) != FenOk;
+}
+
+// unpack into a compact position for copy-make, so playing moves allocates nothing
+int load_compact_position(const packedPosition* position, compactPosition* compact) {
+    chessboard board;
+    if (load_position(position, &board)) {
+        return 1;
+    }
+    board_to_compact(&board, compact);
+    return 0;
+}
+
+// check that move is one of the legal moves of position
+int is_listed_move(compactPosition* position, unsigned short move) {
+    moveTargets targets;
+    unsigned short moves[CHESS_MAX_MOVES];
+    get_compact_targets(position, &targets);
+    if (!((targets.targets[move & 0x3F] >> ((move >> 6) & 0x3F)) & 1)) {
+        return 0;
+    }
+    int numMoves = write_target_moves(position->pieces, position->turn, &targets, moves);
+    for (int i = 0; i < numMoves; i ++) {
+        if (moves[i] == move) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// pack n fens; positions that are invalid or have more than 32 pieces are zeroed and their
+// errors entry, if errors is not NULL, is set to the fenError or -1; returns the number of failures
+int chess_pack_fens(const char* const* fens, int n, packedPosition* positions, int* errors) {
+    setup();
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        chessboard board;
+        int error = parse_fen((char*) fens[i], &board, NULL);
+        if (!error && pack_position(&board, &positions[i])) {
+            error = -1;
+        }
+        if (error) {
+            memset(&positions[i], 0, sizeof(packedPosition));
+            failures ++;
+        }
+        if (errors) {
+            errors[i] = error;
+        }
+    }
+    return failures;
+}
+
+// write the legal moves of position i to moves[i * CHESS_MAX_MOVES] and their number to counts[i],
+// -1 if the position is invalid; returns the number of invalid positions
+int chess_legal_moves_fen(const char* const* fens, int n, unsigned short* moves, int* counts) {
+    setup();
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        chessboard board;
+        if (parse_fen((char*) fens[i], &board, NULL)) {
+            counts[i] = -1;
+            failures ++;
+            continue;
+        }
+        moveTargets targets;
+        get_move_targets(&board, &targets);
+        counts[i] = get_target_moves(&board, &targets, moves + (size_t) i * CHESS_MAX_MOVES);
+    }
+    return failures;
+}
+
+int chess_legal_moves_packed(const packedPosition* positions, int n, unsigned short* moves, int* counts) {
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        chessboard board;
+        if (load_position(&positions[i], &board)) {
+            counts[i] = -1;
+            failures ++;
+            continue;
+        }
+        moveTargets targets;
+        get_move_targets(&board, &targets);
+        counts[i] = get_target_moves(&board, &targets, moves + (size_t) i * CHESS_MAX_MOVES);
+    }
+    return failures;
+}
+
+// count the legal moves of each position into counts, -1 if invalid; returns the number of invalid positions
+int chess_count_moves_packed(const packedPosition* positions, int n, int* counts) {
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        chessboard board;
+        if (load_position(&positions[i], &board)) {
+            counts[i] = -1;
+            failures ++;
+        } else {
+            counts[i] = count_moves(&board);
+        }
+    }
+    return failures;
+}
+
+// play numMoves moves from start, writing the position after move i to positions[i];
+// returns the number of moves played, which is less than numMoves if a move is illegal
+int chess_apply_moves(const packedPosition* start, const unsigned short* moves, int numMoves, packedPosition* positions) {
+    compactPosition current[2]; // the position before and after each move take turns
+    if (load_compact_position(start, &current[0])) {
+        return 0;
+    }
+    int played = 0;
+    for (; played < numMoves; played ++) {
+        compactPosition* before = &current[played & 1];
+        compactPosition* after = &current[(played + 1) & 1];
+        if (!is_listed_move(before, moves[played])) {
+            break;
+        }
+        make_move_copy(before, after, moves[played]);
+        pack_compact_position(after, &positions[played]);
+    }
+    return played;
+}
+
+// play move i on position i for n positions, writing the results to after; an illegal move or
+// invalid position leaves a zeroed result; returns the number of failures
+int chess_apply_move_batch(const packedPosition* positions, const unsigned short* moves, int n, packedPosition* after) {
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        compactPosition position;
+        compactPosition child;
+        if (load_compact_position(&positions[i], &position) || !is_listed_move(&position, moves[i])) {
+            memset(&after[i], 0, sizeof(packedPosition));
+            failures ++;
+            continue;
+        }
+        make_move_copy(&position, &child, moves[i]);
+        pack_compact_position(&child, &after[i]);
+    }
+    return failures;
+}
+
+// count the leaf nodes at depth of each position into nodes, 0 if invalid; returns the number of invalid positions
+int chess_perft_packed(const packedPosition* positions, int n, int depth, uint64_t* nodes) {
+    int failures = 0;
+    for (int i = 0; i < n; i ++) {
+        compactPosition position;
+        if (load_compact_position(&positions[i], &position)) {
+            nodes[i] = 0;
+            failures ++;
+            continue;
+        }
+        nodes[i] = perft_copy(&position, depth);
+    }
+    return failures;
+}
@@ -0,0 +1,37 @@
+#ifndef CHESSAPI
+#define CHESSAPI
+
+#include <stdint.h>
+#include "pack.h"
+
+// batched entry points of the shared library for callers through a foreign function interface;
+// results are written to flat buffers allocated by the caller, and a position that cannot be used
+// is marked in its result instead of stopping the batch
+
+#define CHESS_MAX_MOVES 256 // stride of move buffers, more than the legal moves of any position
+
+// pack n fens; positions that are invalid or have more than 32 pieces are zeroed and their
+// errors entry, if errors is not NULL, is set to the fenError or -1; returns the number of failures
+int chess_pack_fens(const char* const* fens, int n, packedPosition* positions, int* errors);
+
+// write the legal moves of position i to moves[i * CHESS_MAX_MOVES] and their number to counts[i],
+// -1 if the position is invalid; returns the number of invalid positions
+int chess_legal_moves_fen(const char* const* fens, int n, unsigned short* moves, int* counts);
+
+int chess_legal_moves_packed(const packedPosition* positions, int n, unsigned short* moves, int* counts);
+
+// count the legal moves of each position into counts, -1 if invalid; returns the number of invalid positions
+int chess_count_moves_packed(const packedPosition* positions, int n, int* counts);
+
+// play numMoves moves from start, writing the position after move i to positions[i];
+// returns the number of moves played, which is less than numMoves if a move is illegal
+int chess_apply_moves(const packedPosition* start, const unsigned short* moves, int numMoves, packedPosition* positions);
+
+// play move i on position i for n positions, writing the results to after; an illegal move or
+// invalid position leaves a zeroed result; returns the number of failures
+int chess_apply_move_batch(const packedPosition* positions, const unsigned short* moves, int n, packedPosition* after);
+
+// count the leaf nodes at depth of each position into nodes, 0 if invalid; returns the number of invalid positions
+int chess_perft_packed(const packedPosition* positions, int n, int depth, uint64_t* nodes);
+
+#endif
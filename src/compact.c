@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bitscan.h"
+#include "chess.h"
+#include "eval.h"
+#include "search.h"
+#include "compact.h"
+
+_Static_assert(sizeof(compactPosition) == 128, "compact positions are two cache lines");
+
+void board_to_compact(chessboard* board, compactPosition* position) {
+    memcpy(position->pieces, board->pieces, sizeof(position->pieces));
+    position->key = board->key;
+    position->pawnKey = board->pawnKey;
+    position->mgScore = board->mgScore;
+    position->egScore = board->egScore;
+    position->turn = board->turn;
+    position->castling = board->castling;
+    position->epSquare = board->epSquare;
+    position->phase = board->phase;
+    position->halfMoveClock = board->halfMoveClock;
+    position->fullMoves = board->fullMoves;
+}
+
+// set board to position with an empty state stack
+void compact_to_board(compactPosition* position, chessboard* board) {
+    memcpy(board->pieces, position->pieces, sizeof(board->pieces));
+    board->turn = position->turn;
+    board->castling = position->castling;
+    board->epSquare = position->epSquare;
+    board->halfMoveClock = position->halfMoveClock;
+    board->fullMoves = position->fullMoves;
+    init_board(board);
+}
+
+// fill targets of side to move, or only count moves if targets is NULL; returns number of legal moves
+int get_compact_targets(compactPosition* position, moveTargets* targets) {
+    int turn = position->turn;
+    return generate_targets(position->pieces, turn, position->castling, position->epSquare, targets);
+}
+
+// write legal moves to moves, which must hold 256; returns their number
+int get_compact_moves(compactPosition* position, unsigned short* moves) {
+    moveTargets targets;
+    get_compact_targets(position, &targets);
+    return write_target_moves(position->pieces, position->turn, &targets, moves);
+}
+
+// zobrist key of side to move, castling rights and en passant square
+uint64_t get_compact_state_key(compactPosition* position) {
+    uint64_t key = (position->turn == Black ? zobristTurn : 0) ^ castlingKeys[position->castling];
+    if (can_capture_en_passant(position->pieces, position->turn, position->epSquare)) {
+        key ^= zobristEp[position->epSquare & 7];
+    }
+    return key;
+}
+
+void toggle_piece(compactPosition* position, int piece, int square, int sign) {
+    position->pieces[piece] ^= 1LL << square;
+    position->key ^= zobristPieces[piece][square];
+    if (piece <= WhitePawn) {
+        position->pawnKey ^= zobristPieces[piece][square];
+    }
+    position->mgScore += sign * mgTable[piece][square];
+    position->egScore += sign * egTable[piece][square];
+    position->phase += sign * phaseValues[piece];
+}
+
+// write position after legal move in from to to
+void make_move_copy(compactPosition* from, compactPosition* to, unsigned short move) {
+    *to = *from;
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    int offset = to->turn == White ? 1 : 0;
+    int piece = BlackPawn + offset;
+    while (!((to->pieces[piece] >> start) & 1)) {
+        piece += 2;
+    }
+
+    to->key ^= get_compact_state_key(to); // state keys are replaced after the move
+    to->halfMoveClock ++;
+    if (flag & 4) {
+        int square = flag == 5 ? to->epSquare : end;
+        int captured = WhitePawn - offset;
+        while (!((to->pieces[captured] >> square) & 1)) {
+            captured += 2;
+        }
+        toggle_piece(to, captured, square, -1);
+        to->halfMoveClock = 0;
+    }
+    toggle_piece(to, piece, start, -1);
+    toggle_piece(to, flag & 8 ? promotionPieces[flag & 3] + offset : piece, end, 1);
+    if (flag == 2 || flag == 3) {
+        toggle_piece(to, BlackRook + offset, castleRookStart[flag - 2][from->turn], -1);
+        toggle_piece(to, BlackRook + offset, castleRookEnd[flag - 2][from->turn], 1);
+    }
+
+    if (piece <= WhitePawn) {
+        to->halfMoveClock = 0;
+    }
+    to->castling &= ~(castlingLoss[start] | castlingLoss[end]);
+    to->epSquare = flag == 1 ? end : -1;
+    to->fullMoves += to->turn;
+    to->turn = 1 - to->turn;
+    to->key ^= get_compact_state_key(to);
+}
+
+// count leaf nodes of legal move tree with copy-make
+uint64_t perft_copy(compactPosition* position, int depth) {
+    if (depth == 0) {
+        return 1;
+    } else if (depth == 1) {
+        return get_compact_targets(position, NULL);
+    }
+    unsigned short moves[256];
+    int numMoves = get_compact_moves(position, moves);
+    uint64_t nodes = 0;
+    compactPosition child;
+    for (int i = 0; i < numMoves; i ++) {
+        make_move_copy(position, &child, moves[i]);
+        nodes += perft_copy(&child, depth - 1);
+    }
+    return nodes;
+}
+
+// perft with the same move generation as perft_copy, but make and undo
+uint64_t perft_make_undo(chessboard* board, int depth) {
+    if (depth == 0) {
+        return 1;
+    } else if (depth == 1) {
+        return count_moves(board);
+    }
+    moveTargets targets;
+    unsigned short moves[256];
+    get_move_targets(board, &targets);
+    int numMoves = get_target_moves(board, &targets, moves);
+    uint64_t nodes = 0;
+    for (int i = 0; i < numMoves; i ++) {
+        make_move(board, moves[i]);
+        nodes += perft_make_undo(board, depth - 1);
+        undo_move(board, moves[i]);
+    }
+    return nodes;
+}
+
+// captures first, keeping the generator's order otherwise
+void order_captures(unsigned short* moves, int numMoves) {
+    int next = 0;
+    for (int i = 0; i < numMoves; i ++) {
+        if (moves[i] & 0x4000) {
+            unsigned short move = moves[i];
+            moves[i] = moves[next];
+            moves[next ++] = move;
+        }
+    }
+}
+
+// plain alpha-beta on material and piece-square scores, the same for both position types
+int search_copy(compactPosition* position, int depth, int alpha, int beta, int ply, uint64_t* nodes) {
+    (*nodes) ++;
+    unsigned short moves[256];
+    moveTargets targets;
+    get_compact_targets(position, &targets);
+    if (targets.numMoves == 0) {
+        return targets.checkers ? -MATE_SCORE + ply : 0;
+    } else if (depth == 0) {
+        return taper(position->mgScore, position->egScore, position->phase, position->turn);
+    }
+    int numMoves = write_target_moves(position->pieces, position->turn, &targets, moves);
+    order_captures(moves, numMoves);
+    compactPosition child;
+    for (int i = 0; i < numMoves; i ++) {
+        make_move_copy(position, &child, moves[i]);
+        int score = -search_copy(&child, depth - 1, -beta, -alpha, ply + 1, nodes);
+        if (score >= beta) {
+            return score;
+        } else if (score > alpha) {
+            alpha = score;
+        }
+    }
+    return alpha;
+}
+
+int search_make_undo(chessboard* board, int depth, int alpha, int beta, int ply, uint64_t* nodes) {
+    (*nodes) ++;
+    unsigned short moves[256];
+    moveTargets targets;
+    get_move_targets(board, &targets);
+    if (targets.numMoves == 0) {
+        return targets.checkers ? -MATE_SCORE + ply : 0;
+    } else if (depth == 0) {
+        return taper(board->mgScore, board->egScore, board->phase, board->turn);
+    }
+    int numMoves = get_target_moves(board, &targets, moves);
+    order_captures(moves, numMoves);
+    for (int i = 0; i < numMoves; i ++) {
+        make_move(board, moves[i]);
+        int score = -search_make_undo(board, depth - 1, -beta, -alpha, ply + 1, nodes);
+        undo_move(board, moves[i]);
+        if (score >= beta) {
+            return score;
+        } else if (score > alpha) {
+            alpha = score;
+        }
+    }
+    return alpha;
+}
+
+// compare copy-make with make and undo in perft and a fixed depth search of the bench positions
+int copy_bench(int depth) {
+    int numPositions = NUM_BENCH_FENS;
+    uint64_t nodes[3] = {0, 0, 0};
+    long times[3] = {0, 0, 0};
+    uint64_t searchNodes[2] = {0, 0};
+    long searchTimes[2] = {0, 0};
+    int mismatches = 0;
+    for (int i = 0; i < numPositions; i ++) {
+        chessboard board = new_board(benchFens[i]);
+        compactPosition position;
+        board_to_compact(&board, &position);
+
+        long startTime = get_time_ms();
+        uint64_t listNodes = perft(&board, depth);
+        times[0] += get_time_ms() - startTime;
+        startTime = get_time_ms();
+        uint64_t undoNodes = perft_make_undo(&board, depth);
+        times[1] += get_time_ms() - startTime;
+        startTime = get_time_ms();
+        uint64_t copyNodes = perft_copy(&position, depth);
+        times[2] += get_time_ms() - startTime;
+        nodes[0] += listNodes;
+        nodes[1] += undoNodes;
+        nodes[2] += copyNodes;
+
+        uint64_t undoSearchNodes = 0;
+        uint64_t copySearchNodes = 0;
+        startTime = get_time_ms();
+        int undoScore = search_make_undo(&board, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, &undoSearchNodes);
+        searchTimes[0] += get_time_ms() - startTime;
+        startTime = get_time_ms();
+        int copyScore = search_copy(&position, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, &copySearchNodes);
+        searchTimes[1] += get_time_ms() - startTime;
+        searchNodes[0] += undoSearchNodes;
+        searchNodes[1] += copySearchNodes;
+
+        if (listNodes != undoNodes || listNodes != copyNodes || undoScore != copyScore || undoSearchNodes != copySearchNodes) {
+            printf("mismatch in %s: perft %llu, %llu, %llu, search %d, %d\n", benchFens[i], (unsigned long long) listNodes, (unsigned long long) undoNodes,
+                (unsigned long long) copyNodes, undoScore, copyScore);
+            mismatches ++;
+        }
+        free_board_states(&board);
+    }
+
+    char* names[3] = {"perft, move list, make/undo", "perft, make/undo", "perft, copy-make"};
+    for (int i = 0; i < 3; i ++) {
+        printf("%-28s %llu nodes, %ld ms, %.2f million nodes/s\n", names[i], (unsigned long long) nodes[i], times[i], nodes[i] / 1000.0 / (times[i] + 1));
+    }
+    printf("%-28s %llu nodes, %ld ms, %.2f million nodes/s\n", "search, make/undo", (unsigned long long) searchNodes[0], searchTimes[0],
+        searchNodes[0] / 1000.0 / (searchTimes[0] + 1));
+    printf("%-28s %llu nodes, %ld ms, %.2f million nodes/s\n", "search, copy-make", (unsigned long long) searchNodes[1], searchTimes[1],
+        searchNodes[1] / 1000.0 / (searchTimes[1] + 1));
+    printf("%zu bytes per compact position, %zu per board\n", sizeof(compactPosition), sizeof(chessboard));
+    return mismatches != 0;
+}
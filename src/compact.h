@@ -0,0 +1,45 @@
+#ifndef COMPACT
+#define COMPACT
+
+#include <stdint.h>
+#include "chess.h"
+
+typedef struct compactPosition compactPosition;
+
+// flat position of two cache lines for copy-make: a move is made into a copy,
+// so there is no state stack to undo and positions can be handed between threads freely
+struct compactPosition {
+    uint64_t pieces[12];
+    uint64_t key; // zobrist key, equal to the key of the board
+    uint64_t pawnKey;
+    int32_t mgScore; // midgame material and piece-square score (white - black)
+    int32_t egScore;
+    uint8_t turn;
+    uint8_t castling; // white king side, white queen side, black king side, black queen side from bit 0
+    int8_t epSquare; // square of the pawn that can be captured en passant, -1 if none
+    uint8_t phase;
+    uint16_t halfMoveClock;
+    uint16_t fullMoves;
+} __attribute__((aligned(64)));
+
+void board_to_compact(chessboard* board, compactPosition* position);
+
+// set board to position with an empty state stack
+void compact_to_board(compactPosition* position, chessboard* board);
+
+// fill targets of side to move, or only count moves if targets is NULL; returns number of legal moves
+int get_compact_targets(compactPosition* position, moveTargets* targets);
+
+// write legal moves to moves, which must hold 256; returns their number
+int get_compact_moves(compactPosition* position, unsigned short* moves);
+
+// write position after legal move in from to to
+void make_move_copy(compactPosition* from, compactPosition* to, unsigned short move);
+
+// count leaf nodes of legal move tree with copy-make
+uint64_t perft_copy(compactPosition* position, int depth);
+
+// compare copy-make with make and undo in perft and a fixed depth search of the bench positions
+int copy_bench(int depth);
+
+#endif
@@ -0,0 +1,325 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bitscan.h"
+#include "eval.h"
+#include "nnue.h"
+
+// material values of pawn, knight, bishop, rook, queen and king
+int mgMaterial[6] = {82, 337, 365, 477, 1025, 0};
+int egMaterial[6] = {94, 281, 297, 512, 936, 0};
+
+// piece-square tables from white's point of view, rank 8 first
+// based on https://www.chessprogramming.org/Simplified_Evaluation_Function
+int mgPawnTable[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    10, 10, 20, 30, 30, 20, 10, 10,
+     5,  5, 10, 25, 25, 10,  5,  5,
+     0,  0,  0, 20, 20,  0,  0,  0,
+     5, -5,-10,  0,  0,-10, -5,  5,
+     5, 10, 10,-20,-20, 10, 10,  5,
+     0,  0,  0,  0,  0,  0,  0,  0
+};
+
+int egPawnTable[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+    80, 80, 80, 80, 80, 80, 80, 80,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    30, 30, 30, 30, 30, 30, 30, 30,
+    15, 15, 15, 15, 15, 15, 15, 15,
+     5,  5,  5,  5,  5,  5,  5,  5,
+     0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0
+};
+
+int knightTable[64] = {
+   -50,-40,-30,-30,-30,-30,-40,-50,
+   -40,-20,  0,  0,  0,  0,-20,-40,
+   -30,  0, 10, 15, 15, 10,  0,-30,
+   -30,  5, 15, 20, 20, 15,  5,-30,
+   -30,  0, 15, 20, 20, 15,  0,-30,
+   -30,  5, 10, 15, 15, 10,  5,-30,
+   -40,-20,  0,  5,  5,  0,-20,-40,
+   -50,-40,-30,-30,-30,-30,-40,-50
+};
+
+int bishopTable[64] = {
+   -20,-10,-10,-10,-10,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5, 10, 10,  5,  0,-10,
+   -10,  5,  5, 10, 10,  5,  5,-10,
+   -10,  0, 10, 10, 10, 10,  0,-10,
+   -10, 10, 10, 10, 10, 10, 10,-10,
+   -10,  5,  0,  0,  0,  0,  5,-10,
+   -20,-10,-10,-10,-10,-10,-10,-20
+};
+
+int rookTable[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+     5, 10, 10, 10, 10, 10, 10,  5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+     0,  0,  0,  5,  5,  0,  0,  0
+};
+
+int queenTable[64] = {
+   -20,-10,-10, -5, -5,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5,  5,  5,  5,  0,-10,
+    -5,  0,  5,  5,  5,  5,  0, -5,
+     0,  0,  5,  5,  5,  5,  0, -5,
+   -10,  5,  5,  5,  5,  5,  0,-10,
+   -10,  0,  5,  0,  0,  0,  0,-10,
+   -20,-10,-10, -5, -5,-10,-10,-20
+};
+
+int mgKingTable[64] = {
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -20,-30,-30,-40,-40,-30,-30,-20,
+   -10,-20,-20,-20,-20,-20,-20,-10,
+    20, 20,  0,  0,  0,  0, 20, 20,
+    20, 30, 10,  0,  0, 10, 30, 20
+};
+
+int egKingTable[64] = {
+   -50,-40,-30,-20,-20,-30,-40,-50,
+   -30,-20,-10,  0,  0,-10,-20,-30,
+   -30,-10, 20, 30, 30, 20,-10,-30,
+   -30,-10, 30, 40, 40, 30,-10,-30,
+   -30,-10, 30, 40, 40, 30,-10,-30,
+   -30,-10, 20, 30, 30, 20,-10,-30,
+   -30,-30,  0,  0,  0,  0,-30,-30,
+   -50,-30,-30,-30,-30,-30,-30,-50
+};
+
+int* mgPieceTables[6] = {mgPawnTable, knightTable, bishopTable, rookTable, queenTable, mgKingTable};
+int* egPieceTables[6] = {egPawnTable, knightTable, bishopTable, rookTable, queenTable, egKingTable};
+
+int mgTable[12][64];
+int egTable[12][64];
+
+int phaseValues[12] = {0, 0, 1, 1, 1, 1, 2, 2, 4, 4, 0, 0};
+
+// pawn structure terms
+int mgDoubled = -10, egDoubled = -20;
+int mgIsolated = -10, egIsolated = -15;
+int mgBackward = -8, egBackward = -10;
+int mgPassed[8] = {0, 5, 10, 15, 25, 40, 60, 0}; // by relative rank
+int egPassed[8] = {0, 10, 20, 35, 60, 100, 150, 0};
+
+uint64_t fileMasks[8];
+uint64_t adjacentFileMasks[8];
+uint64_t passedMasks[2][64]; // squares in front of pawn on own and adjacent files
+uint64_t supportMasks[2][64]; // squares beside and behind pawn on adjacent files
+
+// setup material, piece-square and pawn structure tables
+void setup_eval_tables() {
+    for (int piece = 0; piece < 12; piece ++) {
+        int type = piece / 2;
+        for (int square = 0; square < 64; square ++) {
+            if (piece & 1) {
+                // white piece; tables are stored with rank 8 first
+                mgTable[piece][square] = mgMaterial[type] + mgPieceTables[type][square ^ 56];
+                egTable[piece][square] = egMaterial[type] + egPieceTables[type][square ^ 56];
+            } else {
+                // black piece; mirrored square is already rank 8 first
+                mgTable[piece][square] = -(mgMaterial[type] + mgPieceTables[type][square]);
+                egTable[piece][square] = -(egMaterial[type] + egPieceTables[type][square]);
+            }
+        }
+    }
+
+    for (int col = 0; col < 8; col ++) {
+        fileMasks[col] = 0x101010101010101LL << col;
+    }
+    for (int col = 0; col < 8; col ++) {
+        adjacentFileMasks[col] = east_one(fileMasks[col]) | west_one(fileMasks[col]);
+    }
+
+    for (int square = 0; square < 64; square ++) {
+        int row = square / 8;
+        int col = square % 8;
+        uint64_t span = fileMasks[col] | adjacentFileMasks[col];
+        uint64_t above = row < 7 ? 0xFFFFFFFFFFFFFFFFULL << (row * 8 + 8) : 0LL;
+        uint64_t below = row > 0 ? 0xFFFFFFFFFFFFFFFFULL >> (64 - row * 8) : 0LL;
+        passedMasks[White][square] = span & above;
+        passedMasks[Black][square] = span & below;
+        supportMasks[White][square] = adjacentFileMasks[col] & ~above;
+        supportMasks[Black][square] = adjacentFileMasks[col] & ~below;
+    }
+}
+
+// evaluate pawn structure of one side
+void evaluate_pawns_side(uint64_t pawns, uint64_t opponentPawns, uint64_t opponentAttacks, pieceColor side, int* mgPtr, int* egPtr, uint64_t* passedPtr) {
+    int mg = 0;
+    int eg = 0;
+    uint64_t passed = 0;
+
+    for (int col = 0; col < 8; col ++) {
+        int count = popCount(pawns & fileMasks[col]);
+        if (count > 1) {
+            mg += mgDoubled * (count - 1);
+            eg += egDoubled * (count - 1);
+        }
+    }
+
+    uint64_t remaining = pawns;
+    while (remaining) {
+        int square = bitscan_forward(remaining);
+        int col = square % 8;
+        int relativeRow = side == White ? square / 8 : 7 - square / 8;
+        int stopSquare = side == White ? square + 8 : square - 8;
+
+        if (!(opponentPawns & passedMasks[side][square])) {
+            passed |= 1LL << square;
+            mg += mgPassed[relativeRow];
+            eg += egPassed[relativeRow];
+        }
+
+        if (!(pawns & adjacentFileMasks[col])) {
+            mg += mgIsolated;
+            eg += egIsolated;
+        } else if (!(pawns & supportMasks[side][square]) && ((opponentAttacks >> stopSquare) & 1)) {
+            mg += mgBackward;
+            eg += egBackward;
+        }
+
+        remaining &= remaining - 1;
+    }
+
+    *mgPtr = mg;
+    *egPtr = eg;
+    *passedPtr = passed;
+}
+
+// evaluate pawn structure of board into entry
+void evaluate_pawns(chessboard* board, pawnEntry* entry) {
+    uint64_t whitePawns = board->pieces[WhitePawn];
+    uint64_t blackPawns = board->pieces[BlackPawn];
+    uint64_t whiteAttacks = east_one(whitePawns << 8) | west_one(whitePawns << 8);
+    uint64_t blackAttacks = east_one(blackPawns >> 8) | west_one(blackPawns >> 8);
+    int whiteMg, whiteEg, blackMg, blackEg;
+
+    evaluate_pawns_side(whitePawns, blackPawns, blackAttacks, White, &whiteMg, &whiteEg, &entry->passed[White]);
+    evaluate_pawns_side(blackPawns, whitePawns, whiteAttacks, Black, &blackMg, &blackEg, &entry->passed[Black]);
+
+    entry->key = board->pawnKey;
+    entry->mgScore = whiteMg - blackMg;
+    entry->egScore = whiteEg - blackEg;
+}
+
+// allocate pawn hash table with a power of two number of entries
+pawnTable* new_pawn_table(int numEntries) {
+    pawnTable* table = (pawnTable*) malloc(sizeof(pawnTable));
+    table->entries = (pawnEntry*) aligned_alloc(64, sizeof(pawnEntry) * numEntries);
+    table->mask = numEntries - 1;
+    table->probes = 0;
+    table->hits = 0;
+    memset(table->entries, 0, sizeof(pawnEntry) * numEntries); // zeroed entry is valid for no pawns
+    return table;
+}
+
+void free_pawn_table(pawnTable* table) {
+    free(table->entries);
+    free(table);
+}
+
+// look up pawn structure of board, evaluating and storing it on a miss
+pawnEntry* probe_pawn_table(pawnTable* table, chessboard* board) {
+    pawnEntry* entry = &table->entries[board->pawnKey & table->mask];
+    table->probes ++;
+    if (entry->key == board->pawnKey) {
+        table->hits ++;
+    } else {
+        evaluate_pawns(board, entry);
+    }
+    return entry;
+}
+
+// print pawn hash table hit rate
+void print_pawn_table_stats(pawnTable* table) {
+    double hitRate = table->probes ? 100.0 * table->hits / table->probes : 0.0;
+    printf("pawn hash: %llu probes, %llu hits (%.1f%%)\n", (unsigned long long) table->probes, (unsigned long long) table->hits, hitRate);
+}
+
+// compute accumulators from piece bitboards
+void get_eval_scores(chessboard* board, int* mgPtr, int* egPtr, int* phasePtr) {
+    int mg = 0;
+    int eg = 0;
+    int phase = 0;
+    for (int piece = 0; piece < 12; piece ++) {
+        uint64_t bitboard = board->pieces[piece];
+        while (bitboard) {
+            int square = bitscan_forward(bitboard);
+            mg += mgTable[piece][square];
+            eg += egTable[piece][square];
+            phase += phaseValues[piece];
+            bitboard &= bitboard - 1;
+        }
+    }
+    *mgPtr = mg;
+    *egPtr = eg;
+    *phasePtr = phase;
+}
+
+// recompute evaluation accumulators of board from scratch
+void init_eval(chessboard* board) {
+    get_eval_scores(board, &board->mgScore, &board->egScore, &board->phase);
+}
+
+// blend midgame and endgame scores by phase
+int taper(int mg, int eg, int phase, pieceColor turn) {
+    if (phase > MAX_PHASE) {
+        phase = MAX_PHASE; // early promotion
+    }
+    int score = (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE;
+    return turn == White ? score : -score;
+}
+
+// get tapered evaluation from accumulators relative to side to move
+// pawn structure is cached in table unless it is NULL
+int evaluate(chessboard* board, pawnTable* table) {
+    if (board->accumulator) {
+        return nnue_evaluate(board);
+    }
+    pawnEntry localEntry;
+    pawnEntry* pawns = &localEntry;
+    if (table) {
+        pawns = probe_pawn_table(table, board);
+    } else {
+        evaluate_pawns(board, pawns);
+    }
+    return taper(board->mgScore + pawns->mgScore, board->egScore + pawns->egScore, board->phase, board->turn);
+}
+
+// get tapered evaluation from piece bitboards relative to side to move
+int evaluate_full(chessboard* board) {
+    int mg, eg, phase;
+    pawnEntry pawns;
+    get_eval_scores(board, &mg, &eg, &phase);
+    evaluate_pawns(board, &pawns);
+    return taper(mg + pawns.mgScore, eg + pawns.egScore, phase, board->turn);
+}
+
+// abort if incremental and full evaluations disagree
+void verify_eval(chessboard* board) {
+    int mg, eg, phase;
+    get_eval_scores(board, &mg, &eg, &phase);
+    uint64_t pawnKey = get_pawn_key(board);
+    uint64_t key = get_key(board);
+    if (mg != board->mgScore || eg != board->egScore || phase != board->phase || pawnKey != board->pawnKey || key != board->key) {
+        fprintf(stderr, "eval mismatch: incremental (%d, %d, %d, %llx) full (%d, %d, %d, %llx)\n", board->mgScore, board->egScore, board->phase, (unsigned long long) board->pawnKey, mg, eg, phase, (unsigned long long) pawnKey);
+        if (key != board->key) {
+            fprintf(stderr, "key mismatch: incremental %llx full %llx\n", (unsigned long long) board->key, (unsigned long long) key);
+        }
+        print_board(board);
+        abort();
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef EVAL
+#define EVAL
+
+#include "chess.h"
+
+// phase of the starting position (all minor and major pieces on the board)
+#define MAX_PHASE 24
+
+// material plus piece-square value of each piece on each square (white - black)
+extern int mgTable[12][64];
+extern int egTable[12][64];
+
+// contribution of each piece to the game phase
+extern int phaseValues[12];
+
+typedef struct pawnEntry pawnEntry;
+
+// cached pawn structure evaluation; two entries per cache line
+struct pawnEntry {
+    uint64_t key;
+    uint64_t passed[2]; // passed pawns of each color
+    int mgScore; // midgame pawn structure score (white - black)
+    int egScore; // endgame pawn structure score (white - black)
+};
+
+typedef struct pawnTable pawnTable;
+
+struct pawnTable {
+    pawnEntry* entries;
+    uint64_t mask; // number of entries - 1
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// setup material, piece-square and pawn structure tables
+void setup_eval_tables();
+
+// allocate pawn hash table with a power of two number of entries
+pawnTable* new_pawn_table(int numEntries);
+
+void free_pawn_table(pawnTable* table);
+
+// look up pawn structure of board, evaluating and storing it on a miss
+pawnEntry* probe_pawn_table(pawnTable* table, chessboard* board);
+
+// print pawn hash table hit rate
+void print_pawn_table_stats(pawnTable* table);
+
+// recompute evaluation accumulators of board from scratch
+void init_eval(chessboard* board);
+
+// blend midgame and endgame scores by phase
+int taper(int mg, int eg, int phase, pieceColor turn);
+
+// get tapered evaluation from accumulators relative to side to move
+// pawn structure is cached in table unless it is NULL
+// uses the nnue instead when the board has an accumulator attached
+int evaluate(chessboard* board, pawnTable* table);
+
+// get tapered evaluation from piece bitboards relative to side to move
+int evaluate_full(chessboard* board);
+
+// abort if incremental and full evaluations disagree
+void verify_eval(chessboard* board);
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "chess.h"
+#include "nnue.h"
+#include "search.h"
+#include "uci.h"
+#include "perft.h"
+#include "pgn.h"
+#include "pack.h"
+#include "selfplay.h"
+#include "book.h"
+#include "compact.h"
+#include "quad.h"
+#include "batch.h"
+#include "bench.h"
+
+// the shared library is built without this file and has no command line
+int main(int argc, char* argv[]) {
+    setup();
+    if (argc == 3 && strcmp(argv[1], "nnue-check") == 0) {
+        return nnue_check(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "nnue-random") == 0) {
+        return nnue_write_random(argv[2], 1);
+    } else if (argc >= 3 && argc <= 5 && strcmp(argv[1], "perft-epd") == 0) {
+        // perft-epd <file> [max depth] [threads]
+        int maxDepth = argc > 3 ? atoi(argv[3]) : MAX_PERFT_DEPTH;
+        int numThreads = argc > 4 ? atoi(argv[4]) : sysconf(_SC_NPROCESSORS_ONLN);
+        return perft_epd(argv[2], maxDepth, numThreads > 0 ? numThreads : 1) != 0;
+    } else if ((argc == 3 || argc == 4) && strcmp(argv[1], "pgn-bench") == 0) {
+        // pgn-bench <file> [threads]
+        int numThreads = argc > 3 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+        return pgn_bench(argv[2], numThreads > 0 ? numThreads : 1);
+    } else if (argc >= 3 && argc <= 6 && strcmp(argv[1], "selfplay") == 0) {
+        // selfplay <output> [games] [nodes] [threads]
+        selfplayOptions options;
+        init_selfplay_options(&options);
+        options.path = argv[2];
+        if (argc > 3) {
+            options.numGames = atoi(argv[3]);
+        }
+        if (argc > 4) {
+            options.nodes = atoll(argv[4]);
+        }
+        options.numThreads = argc > 5 ? atoi(argv[5]) : sysconf(_SC_NPROCESSORS_ONLN);
+        if (options.numThreads < 1) {
+            options.numThreads = 1;
+        }
+        return selfplay(&options);
+    } else if (argc >= 4 && argc <= 6 && strcmp(argv[1], "book-build") == 0) {
+        // book-build <games> <book> [max plies] [min games]
+        int maxPlies = argc > 4 ? atoi(argv[4]) : BOOK_MAX_PLIES;
+        int minGames = argc > 5 ? atoi(argv[5]) : 1;
+        return build_book(argv[2], argv[3], maxPlies, minGames);
+    } else if (argc == 4 && strcmp(argv[1], "book-probe") == 0) {
+        return book_probe_fen(argv[2], argv[3]);
+    } else if (argc == 4 && strcmp(argv[1], "pack-check") == 0) {
+        return pack_check(argv[2], argv[3]);
+    } else if (argc == 3 && strcmp(argv[1], "fen-bench") == 0) {
+        return fen_bench(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "movegen-bench") == 0) {
+        return movegen_bench(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "quad-bench") == 0) {
+        return quad_bench(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "slider-bench") == 0) {
+        return slider_bench(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "batch-bench") == 0) {
+        return batch_bench(argv[2]);
+    } else if (argc >= 2 && argc <= 3 && strcmp(argv[1], "copy-bench") == 0) {
+        return copy_bench(argc == 3 ? atoi(argv[2]) : 4);
+    } else if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        // bench [depth] [no-null] [no-lmr] [no-futility] [no-razoring] [no-extensions] [no-see] [no-delta]
+        searchOptions options;
+        init_search_options(&options);
+        int depth = 6;
+        for (int i = 2; i < argc; i ++) {
+            if (strcmp(argv[i], "no-null") == 0) {
+                options.nullMove = 0;
+            } else if (strcmp(argv[i], "no-lmr") == 0) {
+                options.lateMoveReductions = 0;
+            } else if (strcmp(argv[i], "no-futility") == 0) {
+                options.futility = 0;
+            } else if (strcmp(argv[i], "no-razoring") == 0) {
+                options.razoring = 0;
+            } else if (strcmp(argv[i], "no-see") == 0) {
+                options.seePruning = 0;
+            } else if (strcmp(argv[i], "no-delta") == 0) {
+                options.deltaPruning = 0;
+            } else if (strcmp(argv[i], "no-extensions") == 0) {
+                options.checkExtensions = 0;
+            } else {
+                depth = atoi(argv[i]);
+            }
+        }
+        return bench(depth, &options);
+    }
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "uci") == 0)) {
+        return uci_loop();
+    }
+    printf("usage: %s [uci | bench [depth] [no-*] | fen-bench <file> | movegen-bench <file> | copy-bench [depth] | quad-bench <file> | slider-bench <file> | batch-bench <file> | perft-epd <file> [depth] [threads] | pgn-bench <file> [threads] | pack-check <fen file> <games file> | selfplay <output> [games] [nodes] [threads] | book-build <games> <book> [max plies] [min games] | book-probe <book> <fen> | nnue-check <file> | nnue-random <file>]\n", argv[0]);
+    return 1;
+}
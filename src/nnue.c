@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bitscan.h"
+#include "nnue.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// layout of network file after header
+#define FT_WEIGHTS_OFFSET 16
+#define FT_BIAS_OFFSET (FT_WEIGHTS_OFFSET + NNUE_INPUTS * NNUE_HIDDEN * 2)
+#define L1_WEIGHTS_OFFSET (FT_BIAS_OFFSET + NNUE_HIDDEN * 2)
+#define L1_BIAS_OFFSET (L1_WEIGHTS_OFFSET + NNUE_L1 * 2 * NNUE_HIDDEN)
+#define L2_WEIGHTS_OFFSET (L1_BIAS_OFFSET + NNUE_L1 * 4)
+#define L2_BIAS_OFFSET (L2_WEIGHTS_OFFSET + NNUE_L1)
+#define NETWORK_SIZE (L2_BIAS_OFFSET + 4)
+
+#define L1_SHIFT 6 // scale of first hidden layer
+#define OUTPUT_SCALE 16 // network output units per centipawn
+
+// memory-map network file; returns NULL if it cannot be read
+nnueNetwork* nnue_load(char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "nnue: cannot open %s\n", path);
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size != NETWORK_SIZE) {
+        fprintf(stderr, "nnue: %s has wrong size\n", path);
+        close(fd);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "nnue: cannot map %s\n", path);
+        return NULL;
+    }
+
+    const uint32_t* header = (const uint32_t*) mapping;
+    if (header[0] != NNUE_MAGIC || header[1] != NNUE_VERSION || header[2] != NNUE_HIDDEN || header[3] != NNUE_L1) {
+        fprintf(stderr, "nnue: %s is not a compatible network\n", path);
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+
+    nnueNetwork* nnue = (nnueNetwork*) malloc(sizeof(nnueNetwork));
+    const char* base = (const char*) mapping;
+    nnue->mapping = mapping;
+    nnue->size = info.st_size;
+    nnue->ftWeights = (const int16_t*) (base + FT_WEIGHTS_OFFSET);
+    nnue->ftBias = (const int16_t*) (base + FT_BIAS_OFFSET);
+    nnue->l1Weights = (const int8_t*) (base + L1_WEIGHTS_OFFSET);
+    nnue->l1Bias = (const int32_t*) (base + L1_BIAS_OFFSET);
+    nnue->l2Weights = (const int8_t*) (base + L2_WEIGHTS_OFFSET);
+    nnue->l2Bias = (const int32_t*) (base + L2_BIAS_OFFSET);
+    return nnue;
+}
+
+void nnue_unload(nnueNetwork* network) {
+    if (network) {
+        munmap(network->mapping, network->size);
+        free(network);
+    }
+}
+
+// linear congruential generator for network initialization
+uint32_t next_random(uint32_t* state) {
+    *state = *state * 1103515245 + 12345;
+    return *state >> 16;
+}
+
+// write a randomly initialized network in the file format
+int nnue_write_random(char* path, unsigned int seed) {
+    char* data = (char*) calloc(NETWORK_SIZE, 1);
+    uint32_t header[4] = {NNUE_MAGIC, NNUE_VERSION, NNUE_HIDDEN, NNUE_L1};
+    memcpy(data, header, sizeof(header));
+
+    uint32_t state = seed;
+    int16_t* ftWeights = (int16_t*) (data + FT_WEIGHTS_OFFSET);
+    for (int i = 0; i < NNUE_INPUTS * NNUE_HIDDEN; i ++) {
+        ftWeights[i] = next_random(&state) % 17 - 8;
+    }
+    int16_t* ftBias = (int16_t*) (data + FT_BIAS_OFFSET);
+    for (int i = 0; i < NNUE_HIDDEN; i ++) {
+        ftBias[i] = next_random(&state) % 65;
+    }
+    int8_t* l1Weights = (int8_t*) (data + L1_WEIGHTS_OFFSET);
+    for (int i = 0; i < NNUE_L1 * 2 * NNUE_HIDDEN; i ++) {
+        l1Weights[i] = next_random(&state) % 129 - 64;
+    }
+    int32_t* l1Bias = (int32_t*) (data + L1_BIAS_OFFSET);
+    for (int i = 0; i < NNUE_L1; i ++) {
+        l1Bias[i] = next_random(&state) % 2049 - 1024;
+    }
+    int8_t* l2Weights = (int8_t*) (data + L2_WEIGHTS_OFFSET);
+    for (int i = 0; i < NNUE_L1; i ++) {
+        l2Weights[i] = next_random(&state) % 129 - 64;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        free(data);
+        return 1;
+    }
+    size_t written = fwrite(data, 1, NETWORK_SIZE, file);
+    fclose(file);
+    free(data);
+    return written == NETWORK_SIZE ? 0 : 1;
+}
+
+// get input index of piece on square from perspective of side
+int feature_index(int piece, int square, pieceColor side) {
+    if (side == Black) {
+        piece ^= 1; // swap colors
+        square ^= 56; // flip ranks
+    }
+    return piece * 64 + square;
+}
+
+// add or subtract weights of one input to a perspective of accumulator
+void update_perspective(int16_t* values, const int16_t* weights, int add) {
+#if defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i v = _mm256_load_si256((__m256i*) (values + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*) (weights + i));
+        v = add ? _mm256_add_epi16(v, w) : _mm256_sub_epi16(v, w);
+        _mm256_store_si256((__m256i*) (values + i), v);
+    }
+#elif defined(__SSSE3__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i v = _mm_load_si128((__m128i*) (values + i));
+        __m128i w = _mm_loadu_si128((const __m128i*) (weights + i));
+        v = add ? _mm_add_epi16(v, w) : _mm_sub_epi16(v, w);
+        _mm_store_si128((__m128i*) (values + i), v);
+    }
+#elif defined(__ARM_NEON)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        int16x8_t v = vld1q_s16(values + i);
+        int16x8_t w = vld1q_s16(weights + i);
+        vst1q_s16(values + i, add ? vaddq_s16(v, w) : vsubq_s16(v, w));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i ++) {
+        values[i] = add ? values[i] + weights[i] : values[i] - weights[i];
+    }
+#endif
+}
+
+void nnue_add_feature(nnueAccumulator* accumulator, int piece, int square) {
+    for (int side = White; side <= Black; side ++) {
+        update_perspective(accumulator->values[side], accumulator->network->ftWeights + feature_index(piece, square, side) * NNUE_HIDDEN, 1);
+    }
+}
+
+void nnue_remove_feature(nnueAccumulator* accumulator, int piece, int square) {
+    for (int side = White; side <= Black; side ++) {
+        update_perspective(accumulator->values[side], accumulator->network->ftWeights + feature_index(piece, square, side) * NNUE_HIDDEN, 0);
+    }
+}
+
+// recompute accumulator of board from its pieces with the weights of network
+void nnue_refresh(chessboard* board, nnueAccumulator* accumulator, const nnueNetwork* network) {
+    accumulator->network = network;
+    for (int side = White; side <= Black; side ++) {
+        memcpy(accumulator->values[side], network->ftBias, sizeof(int16_t) * NNUE_HIDDEN);
+    }
+    for (int piece = 0; piece < 12; piece ++) {
+        uint64_t bitboard = board->pieces[piece];
+        while (bitboard) {
+            nnue_add_feature(accumulator, piece, bitscan_forward(bitboard));
+            bitboard &= bitboard - 1;
+        }
+    }
+}
+
+// keep accumulator updated by make_move and undo_move; NULL detaches
+void nnue_attach(chessboard* board, nnueAccumulator* accumulator, const nnueNetwork* network) {
+    board->accumulator = accumulator;
+    if (accumulator) {
+        nnue_refresh(board, accumulator, network);
+    }
+}
+
+// output layer shared by all kernels
+int output_layer(const nnueNetwork* nnue, int32_t* hidden) {
+    int32_t sum = nnue->l2Bias[0];
+    for (int j = 0; j < NNUE_L1; j ++) {
+        sum += hidden[j] * nnue->l2Weights[j];
+    }
+    return sum / OUTPUT_SCALE;
+}
+
+int32_t clamp_hidden(int32_t sum) {
+    sum >>= L1_SHIFT;
+    return sum < 0 ? 0 : (sum > 127 ? 127 : sum);
+}
+
+int forward_scalar(nnueAccumulator* accumulator, pieceColor turn) {
+    const nnueNetwork* nnue = accumulator->network;
+    uint8_t input[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; i ++) {
+        int16_t us = accumulator->values[turn][i];
+        int16_t them = accumulator->values[1 - turn][i];
+        input[i] = us < 0 ? 0 : (us > 127 ? 127 : us);
+        input[NNUE_HIDDEN + i] = them < 0 ? 0 : (them > 127 ? 127 : them);
+    }
+
+    int32_t hidden[NNUE_L1];
+    for (int j = 0; j < NNUE_L1; j ++) {
+        const int8_t* weights = nnue->l1Weights + j * 2 * NNUE_HIDDEN;
+        int32_t sum = nnue->l1Bias[j];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i ++) {
+            sum += input[i] * weights[i];
+        }
+        hidden[j] = clamp_hidden(sum);
+    }
+
+    return output_layer(nnue, hidden);
+}
+
+#if defined(__AVX2__)
+int forward_simd(nnueAccumulator* accumulator, pieceColor turn) {
+    const nnueNetwork* nnue = accumulator->network;
+    uint8_t input[2 * NNUE_HIDDEN] __attribute__((aligned(32)));
+    __m256i zero = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi16(127);
+    for (int half = 0; half < 2; half ++) {
+        int16_t* values = accumulator->values[half ? 1 - turn : turn];
+        for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+            __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((__m256i*) (values + i)), zero), max);
+            __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((__m256i*) (values + i + 16)), zero), max);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8); // undo lane interleave
+            _mm256_store_si256((__m256i*) (input + half * NNUE_HIDDEN + i), packed);
+        }
+    }
+
+    int32_t hidden[NNUE_L1];
+    __m256i ones = _mm256_set1_epi16(1);
+    for (int j = 0; j < NNUE_L1; j ++) {
+        const int8_t* weights = nnue->l1Weights + j * 2 * NNUE_HIDDEN;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 32) {
+            __m256i x = _mm256_load_si256((__m256i*) (input + i));
+            __m256i w = _mm256_loadu_si256((const __m256i*) (weights + i));
+            // inputs are at most 127 so pairwise products cannot saturate
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+        hidden[j] = clamp_hidden(nnue->l1Bias[j] + _mm_cvtsi128_si32(total));
+    }
+
+    return output_layer(nnue, hidden);
+}
+#elif defined(__SSSE3__)
+int forward_simd(nnueAccumulator* accumulator, pieceColor turn) {
+    const nnueNetwork* nnue = accumulator->network;
+    uint8_t input[2 * NNUE_HIDDEN] __attribute__((aligned(16)));
+    __m128i zero = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16(127);
+    for (int half = 0; half < 2; half ++) {
+        int16_t* values = accumulator->values[half ? 1 - turn : turn];
+        for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+            __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((__m128i*) (values + i)), zero), max);
+            __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((__m128i*) (values + i + 8)), zero), max);
+            _mm_store_si128((__m128i*) (input + half * NNUE_HIDDEN + i), _mm_packus_epi16(a, b));
+        }
+    }
+
+    int32_t hidden[NNUE_L1];
+    __m128i ones = _mm_set1_epi16(1);
+    for (int j = 0; j < NNUE_L1; j ++) {
+        const int8_t* weights = nnue->l1Weights + j * 2 * NNUE_HIDDEN;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16) {
+            __m128i x = _mm_load_si128((__m128i*) (input + i));
+            __m128i w = _mm_loadu_si128((const __m128i*) (weights + i));
+            // inputs are at most 127 so pairwise products cannot saturate
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        hidden[j] = clamp_hidden(nnue->l1Bias[j] + _mm_cvtsi128_si32(sum));
+    }
+
+    return output_layer(nnue, hidden);
+}
+#elif defined(__ARM_NEON)
+int forward_simd(nnueAccumulator* accumulator, pieceColor turn) {
+    const nnueNetwork* nnue = accumulator->network;
+    int8_t input[2 * NNUE_HIDDEN] __attribute__((aligned(16)));
+    int16x8_t zero = vdupq_n_s16(0);
+    int16x8_t max = vdupq_n_s16(127);
+    for (int half = 0; half < 2; half ++) {
+        int16_t* values = accumulator->values[half ? 1 - turn : turn];
+        for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+            int16x8_t v = vminq_s16(vmaxq_s16(vld1q_s16(values + i), zero), max);
+            vst1_s8(input + half * NNUE_HIDDEN + i, vmovn_s16(v)); // at most 127, fits signed
+        }
+    }
+
+    int32_t hidden[NNUE_L1];
+    for (int j = 0; j < NNUE_L1; j ++) {
+        const int8_t* weights = nnue->l1Weights + j * 2 * NNUE_HIDDEN;
+        int32x4_t sum = vdupq_n_s32(0);
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16) {
+            int8x16_t x = vld1q_s8(input + i);
+            int8x16_t w = vld1q_s8(weights + i);
+            sum = vpadalq_s16(sum, vmull_s8(vget_low_s8(x), vget_low_s8(w)));
+            sum = vpadalq_s16(sum, vmull_s8(vget_high_s8(x), vget_high_s8(w)));
+        }
+        hidden[j] = clamp_hidden(nnue->l1Bias[j] + vaddvq_s32(sum));
+    }
+
+    return output_layer(nnue, hidden);
+}
+#else
+int forward_simd(nnueAccumulator* accumulator, pieceColor turn) {
+    return forward_scalar(accumulator, turn);
+}
+#endif
+
+// evaluate board relative to side to move using its accumulator
+int nnue_evaluate(chessboard* board) {
+    return forward_simd(board->accumulator, board->turn);
+}
+
+// evaluate with the portable kernels only
+int nnue_evaluate_scalar(chessboard* board) {
+    return forward_scalar(board->accumulator, board->turn);
+}
+
+// compare kernels and accumulators at every node of tree
+void check_tree(chessboard* board, int depth, long* nodes, long* mismatches) {
+    nnueAccumulator fresh;
+    nnue_refresh(board, &fresh, board->accumulator->network);
+    (*nodes) ++;
+    if (memcmp(fresh.values, board->accumulator->values, sizeof(fresh.values)) != 0 || nnue_evaluate(board) != nnue_evaluate_scalar(board)) {
+        (*mismatches) ++;
+    }
+    if (depth == 0) {
+        return;
+    }
+    shortlist* moves = get_all_moves(board);
+    for (shortlist* tail = moves; tail; tail = tail->next) {
+        make_move(board, tail->val);
+        check_tree(board, depth - 1, nodes, mismatches);
+        undo_move(board, tail->val);
+    }
+    int length;
+    free(list_to_arr(moves, &length));
+}
+
+// check SIMD against scalar kernels and incremental against refreshed accumulators
+int nnue_check(char* path) {
+    nnueNetwork* network = nnue_load(path);
+    if (!network) {
+        return 1;
+    }
+    char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P3/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1"
+    };
+    long nodes = 0;
+    long mismatches = 0;
+    nnueAccumulator accumulator;
+    for (int i = 0; i < 4; i ++) {
+        chessboard board = new_board(fens[i]);
+        nnue_attach(&board, &accumulator, network);
+        printf("%s\neval %d (scalar %d)\n", fens[i], nnue_evaluate(&board), nnue_evaluate_scalar(&board));
+        check_tree(&board, 3, &nodes, &mismatches);
+        free_board_states(&board);
+    }
+    printf("checked %ld positions, %ld mismatches\n", nodes, mismatches);
+    nnue_unload(network);
+    return mismatches > 0;
+}
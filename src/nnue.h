@@ -0,0 +1,66 @@
+#ifndef NNUE
+#define NNUE
+
+#include <stdint.h>
+#include <stddef.h>
+#include "chess.h"
+
+// network dimensions: (768 -> 128) x 2 perspectives -> 32 -> 1
+#define NNUE_INPUTS 768
+#define NNUE_HIDDEN 128
+#define NNUE_L1 32
+
+#define NNUE_MAGIC 0x45554e43 // "CNUE"
+#define NNUE_VERSION 1
+
+typedef struct nnueNetwork nnueNetwork;
+
+// first layer outputs for white's and black's perspective
+struct nnueAccumulator {
+    int16_t values[2][NNUE_HIDDEN] __attribute__((aligned(32)));
+    const nnueNetwork* network; // weights the values were computed with
+};
+
+typedef struct nnueAccumulator nnueAccumulator;
+
+// weights point into the memory-mapped network file
+struct nnueNetwork {
+    void* mapping;
+    size_t size;
+    const int16_t* ftWeights; // [NNUE_INPUTS][NNUE_HIDDEN]
+    const int16_t* ftBias; // [NNUE_HIDDEN]
+    const int8_t* l1Weights; // [NNUE_L1][2 * NNUE_HIDDEN]
+    const int32_t* l1Bias; // [NNUE_L1]
+    const int8_t* l2Weights; // [NNUE_L1]
+    const int32_t* l2Bias; // [1]
+};
+
+// memory-map network file; returns NULL if it cannot be read. A network is only read
+// after loading, so one network can be shared by any number of boards and threads
+nnueNetwork* nnue_load(char* path);
+
+void nnue_unload(nnueNetwork* network);
+
+// write a randomly initialized network in the file format
+int nnue_write_random(char* path, unsigned int seed);
+
+// recompute accumulator of board from its pieces with the weights of network
+void nnue_refresh(chessboard* board, nnueAccumulator* accumulator, const nnueNetwork* network);
+
+// keep accumulator updated by make_move and undo_move; NULL detaches
+void nnue_attach(chessboard* board, nnueAccumulator* accumulator, const nnueNetwork* network);
+
+void nnue_add_feature(nnueAccumulator* accumulator, int piece, int square);
+
+void nnue_remove_feature(nnueAccumulator* accumulator, int piece, int square);
+
+// evaluate board relative to side to move using its accumulator
+int nnue_evaluate(chessboard* board);
+
+// evaluate with the portable kernels only
+int nnue_evaluate_scalar(chessboard* board);
+
+// check SIMD against scalar kernels and incremental against refreshed accumulators
+int nnue_check(char* path);
+
+#endif
@@ -0,0 +1,470 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bitscan.h"
+#include "chess.h"
+#include "search.h"
+#include "pack.h"
+
+_Static_assert(sizeof(packedPosition) == 32, "packed position must be 32 bytes");
+
+// pack pieces and state, with castling rights as bits from white king side; returns 1 if there are more than 32 pieces
+// or a clock does not fit in 16 bits
+int pack_fields(uint64_t* pieces, int turn, int castling, int epSquare, int halfMoveClock, int fullMoves, packedPosition* packed) {
+    if (halfMoveClock < 0 || halfMoveClock > 0xFFFF || fullMoves < 0 || fullMoves > 0xFFFF) {
+        return 1;
+    }
+    int8_t squares[64];
+    uint64_t occupied = 0;
+    for (int piece = 0; piece < 12; piece ++) {
+        uint64_t bitboard = pieces[piece];
+        occupied |= bitboard;
+        while (bitboard) {
+            squares[bitscan_forward(bitboard)] = piece;
+            bitboard &= bitboard - 1;
+        }
+    }
+    if (popCount(occupied) > 32) {
+        return 1;
+    }
+
+    memset(packed, 0, sizeof(packedPosition));
+    packed->occupied = occupied;
+    for (int i = 0; occupied; i ++) {
+        packed->pieces[i / 2] |= squares[bitscan_forward(occupied)] << (4 * (i & 1));
+        occupied &= occupied - 1;
+    }
+    packed->flags = turn | castling << 1;
+    packed->epSquare = epSquare < 0 ? 0xFF : epSquare;
+    packed->halfMoveClock = halfMoveClock;
+    packed->fullMoves = fullMoves;
+    return 0;
+}
+
+// pack board; returns 1 if it has more than 32 pieces or a clock above 65535
+int pack_position(chessboard* board, packedPosition* packed) {
+    return pack_fields(board->pieces, board->turn, board->castling, board->epSquare, board->halfMoveClock, board->fullMoves, packed);
+}
+
+// pack compact position; returns 1 if it has more than 32 pieces or a clock above 65535
+int pack_compact_position(compactPosition* position, packedPosition* packed) {
+    return pack_fields(position->pieces, position->turn, position->castling, position->epSquare, position->halfMoveClock, position->fullMoves, packed);
+}
+
+// unpack and validate position into a board with an empty state stack
+fenError unpack_position(packedPosition* packed, chessboard* board) {
+    for (int piece = 0; piece < 12; piece ++) {
+        board->pieces[piece] = 0;
+    }
+    uint64_t occupied = packed->occupied;
+    if (popCount(occupied) > 32) {
+        return FenBadPiece;
+    }
+    for (int i = 0; occupied; i ++) {
+        int piece = (packed->pieces[i / 2] >> (4 * (i & 1))) & 0xF;
+        if (piece >= 12) {
+            return FenBadPiece;
+        }
+        board->pieces[piece] |= occupied & -occupied;
+        occupied &= occupied - 1;
+    }
+    board->turn = packed->flags & 1;
+    board->castling = (packed->flags >> 1) & 0xF;
+    if (packed->epSquare == 0xFF) {
+        board->epSquare = -1;
+    } else if ((packed->epSquare >> 3) == (board->turn == White ? 4 : 3)) {
+        board->epSquare = packed->epSquare;
+    } else {
+        return FenBadEnPassant;
+    }
+    board->halfMoveClock = packed->halfMoveClock;
+    board->fullMoves = packed->fullMoves;
+
+    fenError error = validate_board(board);
+    if (error) {
+        return error;
+    }
+    init_board(board);
+    return FenOk;
+}
+
+// files are little-endian whatever the byte order of the host
+void put_le16(uint8_t* data, uint16_t value) {
+    data[0] = value;
+    data[1] = value >> 8;
+}
+
+void put_le32(uint8_t* data, uint32_t value) {
+    for (int i = 0; i < 4; i ++) {
+        data[i] = value >> (8 * i);
+    }
+}
+
+void put_le64(uint8_t* data, uint64_t value) {
+    for (int i = 0; i < 8; i ++) {
+        data[i] = value >> (8 * i);
+    }
+}
+
+uint16_t get_le16(const uint8_t* data) {
+    return data[0] | data[1] << 8;
+}
+
+uint32_t get_le32(const uint8_t* data) {
+    return (uint32_t) data[0] | (uint32_t) data[1] << 8 | (uint32_t) data[2] << 16 | (uint32_t) data[3] << 24;
+}
+
+uint64_t get_le64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i --) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+// write packed position as the 32 bytes stored in game files
+void write_packed_position(packedPosition* packed, uint8_t* data) {
+    put_le64(data, packed->occupied);
+    memcpy(data + 8, packed->pieces, 16);
+    data[24] = packed->flags;
+    data[25] = packed->epSquare;
+    put_le16(data + 26, packed->halfMoveClock);
+    put_le16(data + 28, packed->fullMoves);
+    data[30] = 0;
+    data[31] = 0;
+}
+
+void read_packed_position(const uint8_t* data, packedPosition* packed) {
+    packed->occupied = get_le64(data);
+    memcpy(packed->pieces, data + 8, 16);
+    packed->flags = data[24];
+    packed->epSquare = data[25];
+    packed->halfMoveClock = get_le16(data + 26);
+    packed->fullMoves = get_le16(data + 28);
+    packed->reserved[0] = 0;
+    packed->reserved[1] = 0;
+}
+
+gameWriter* open_game_writer(char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return NULL;
+    }
+    uint8_t header[GAMES_HEADER_SIZE] = {0};
+    put_le32(header, GAMES_MAGIC);
+    put_le32(header + 4, GAMES_VERSION);
+    fwrite(header, sizeof(header), 1, file);
+
+    gameWriter* writer = (gameWriter*) malloc(sizeof(gameWriter));
+    writer->file = file;
+    writer->offset = GAMES_HEADER_SIZE;
+    writer->numGames = 0;
+    writer->capacity = 1024;
+    writer->index = (uint64_t*) malloc(sizeof(uint64_t) * writer->capacity);
+    pthread_mutex_init(&writer->lock, NULL);
+    return writer;
+}
+
+void write_game(gameWriter* writer, packedPosition* start, unsigned short* moves, int numMoves, gameResult result) {
+    uint8_t record[GAME_RECORD_SIZE];
+    write_packed_position(start, record);
+    uint16_t count = numMoves;
+    put_le16(record + 32, count);
+    record[34] = result;
+    record[35] = 0;
+
+    pthread_mutex_lock(&writer->lock);
+    if (writer->numGames == writer->capacity) {
+        writer->capacity *= 2;
+        writer->index = (uint64_t*) realloc(writer->index, sizeof(uint64_t) * writer->capacity);
+    }
+    writer->index[writer->numGames ++] = writer->offset;
+    fwrite(record, GAME_RECORD_SIZE, 1, writer->file);
+    for (int i = 0; i < count; i += 256) {
+        uint8_t data[512];
+        int length = count - i < 256 ? count - i : 256;
+        for (int j = 0; j < length; j ++) {
+            put_le16(data + 2 * j, moves[i + j]);
+        }
+        fwrite(data, 2, length, writer->file);
+    }
+    writer->offset += GAME_RECORD_SIZE + 2 * count;
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// write the index and close the file
+void close_game_writer(gameWriter* writer) {
+    // index is aligned to 8 bytes, followed by its offset, number of games and magic
+    uint64_t padding = 0;
+    fwrite(&padding, 1, (8 - writer->offset % 8) % 8, writer->file);
+    uint64_t indexOffset = writer->offset + (8 - writer->offset % 8) % 8;
+    for (uint64_t i = 0; i < writer->numGames; i ++) {
+        uint8_t entry[8];
+        put_le64(entry, writer->index[i]);
+        fwrite(entry, 8, 1, writer->file);
+    }
+    uint8_t footer[24];
+    put_le64(footer, indexOffset);
+    put_le64(footer + 8, writer->numGames);
+    put_le64(footer + 16, GAMES_MAGIC);
+    fwrite(footer, sizeof(footer), 1, writer->file);
+    fclose(writer->file);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->index);
+    free(writer);
+}
+
+// read record at offset; returns offset of the next one, or 0 if it is cut off
+size_t read_record(gameReader* reader, size_t offset, gameRecord* record) {
+    if (offset > reader->size || reader->size - offset < GAME_RECORD_SIZE) {
+        return 0;
+    }
+    uint8_t* data = (uint8_t*) reader->mapping + offset;
+    read_packed_position(data, &record->start);
+    uint16_t count = get_le16(data + 32);
+    record->result = data[34];
+    record->numMoves = count;
+    record->moves = data + GAME_RECORD_SIZE;
+    size_t next = offset + GAME_RECORD_SIZE + 2 * count;
+    return next <= reader->size ? next : 0;
+}
+
+// memory-map game stream; the index is rebuilt by scanning if the writer was not closed
+gameReader* open_game_reader(char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0 || info.st_size < GAMES_HEADER_SIZE) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return NULL;
+    }
+    uint8_t* header = (uint8_t*) mapping;
+    if (get_le32(header) != GAMES_MAGIC || get_le32(header + 4) != GAMES_VERSION) {
+        fprintf(stderr, "%s is not a game file of version %d\n", path, GAMES_VERSION);
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+
+    gameReader* reader = (gameReader*) malloc(sizeof(gameReader));
+    reader->mapping = mapping;
+    reader->size = info.st_size;
+    reader->next = 0;
+
+    // the footer is trusted only if its index lies between the header and the footer
+    uint8_t* footer = (uint8_t*) mapping + reader->size - 24;
+    uint64_t numGames = reader->size >= GAMES_HEADER_SIZE + 24 ? get_le64(footer + 8) : 0;
+    if (reader->size % 8 == 0 && reader->size >= GAMES_HEADER_SIZE + 24 && get_le64(footer + 16) == GAMES_MAGIC &&
+        numGames <= (reader->size - GAMES_HEADER_SIZE - 24) / 8 && get_le64(footer) == reader->size - 24 - numGames * 8) {
+        reader->index = (uint64_t*) malloc(sizeof(uint64_t) * (numGames ? numGames : 1));
+        if (!reader->index) {
+            fprintf(stderr, "cannot allocate index of %s\n", path);
+            close_game_reader(reader);
+            return NULL;
+        }
+        reader->numGames = numGames;
+        uint8_t* entries = (uint8_t*) mapping + get_le64(footer);
+        for (uint64_t i = 0; i < numGames; i ++) {
+            reader->index[i] = get_le64(entries + 8 * i);
+        }
+    } else {
+        // scan records of an unfinished file
+        uint64_t capacity = 1024;
+        reader->index = (uint64_t*) malloc(sizeof(uint64_t) * capacity);
+        reader->numGames = 0;
+        gameRecord record;
+        size_t offset = GAMES_HEADER_SIZE;
+        size_t next;
+        while ((next = read_record(reader, offset, &record))) {
+            if (reader->numGames == capacity) {
+                capacity *= 2;
+                reader->index = (uint64_t*) realloc(reader->index, sizeof(uint64_t) * capacity);
+            }
+            reader->index[reader->numGames ++] = offset;
+            offset = next;
+        }
+    }
+    return reader;
+}
+
+// read game by its number; returns 0 on success
+int read_game(gameReader* reader, uint64_t number, gameRecord* record) {
+    if (number >= reader->numGames) {
+        return 1;
+    }
+    return read_record(reader, reader->index[number], record) == 0;
+}
+
+// read the game after the previous one; returns 0 on success, 1 at the end
+int next_game(gameReader* reader, gameRecord* record) {
+    return read_game(reader, reader->next ++, record);
+}
+
+// get move number i of record
+unsigned short get_record_move(gameRecord* record, int i) {
+    return get_le16(record->moves + 2 * i);
+}
+
+void close_game_reader(gameReader* reader) {
+    munmap(reader->mapping, reader->size);
+    free(reader->index);
+    free(reader);
+}
+
+uint64_t next_pack_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// replay record and compare the final position with fen; returns 0 if they match
+int check_game(gameRecord* record, char* fen) {
+    chessboard board;
+    if (unpack_position(&record->start, &board)) {
+        return 1;
+    }
+    for (int i = 0; i < record->numMoves; i ++) {
+        unsigned short move = get_record_move(record, i);
+        int numMoves;
+        unsigned short* moves = list_to_arr(get_all_moves(&board), &numMoves);
+        int legal = 0;
+        for (int j = 0; j < numMoves; j ++) {
+            legal |= moves[j] == move;
+        }
+        free(moves);
+        if (!legal) {
+            free_board_states(&board);
+            return 1;
+        }
+        make_move(&board, move);
+    }
+    char final[MAX_FEN_LENGTH];
+    board_to_fen(&board, final);
+    free_board_states(&board);
+    return strcmp(final, fen) != 0;
+}
+
+// check position packing against fen and game stream round trips; prints throughput
+int pack_check(char* fenPath, char* gamesPath) {
+    // parse the positions, then time packing and unpacking them
+    chessboard* boards;
+    int numPositions = load_positions(fenPath, &boards, MAX_BENCH_POSITIONS);
+    if (numPositions < 0) {
+        return 1;
+    }
+
+    packedPosition* packed = (packedPosition*) malloc(sizeof(packedPosition) * numPositions);
+    uint8_t* failed = (uint8_t*) malloc(numPositions ? numPositions : 1); // positions that cannot be packed
+    int errors = 0;
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        failed[i] = pack_position(&boards[i], &packed[i]);
+        errors += failed[i];
+    }
+    long packTime = get_time_ms() - startTime;
+
+    int mismatches = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        chessboard board;
+        if (failed[i]) {
+            continue;
+        }
+        if (unpack_position(&packed[i], &board) || board.key != boards[i].key || board.halfMoveClock != boards[i].halfMoveClock || board.fullMoves != boards[i].fullMoves) {
+            mismatches ++;
+        }
+    }
+    long unpackTime = get_time_ms() - startTime;
+
+    // compare text of every position
+    for (int i = 0; i < numPositions; i ++) {
+        chessboard board;
+        char expected[MAX_FEN_LENGTH];
+        char actual[MAX_FEN_LENGTH];
+        board_to_fen(&boards[i], expected);
+        if (failed[i] || unpack_position(&packed[i], &board)) {
+            continue;
+        }
+        board_to_fen(&board, actual);
+        if (strcmp(expected, actual) != 0) {
+            if (mismatches < 10) {
+                fprintf(stderr, "%s unpacked as %s\n", expected, actual);
+            }
+            mismatches ++;
+        }
+    }
+    printf("%d positions of %d bytes, %d not packable, %d mismatches\n", numPositions, (int) sizeof(packedPosition), errors, mismatches);
+    printf("pack: %.2f million positions/s, unpack: %.2f million positions/s\n", numPositions / 1000.0 / (packTime + 1), numPositions / 1000.0 / (unpackTime + 1));
+
+    // write random games from the positions, then read them back in order and by index
+    int numGames = numPositions < 2000 ? numPositions : 2000;
+    char (*finalFens)[MAX_FEN_LENGTH] = malloc(MAX_FEN_LENGTH * (numGames ? numGames : 1));
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    gameWriter* writer = open_game_writer(gamesPath);
+    if (!writer) {
+        return 1;
+    }
+    uint64_t totalMoves = 0;
+    for (int i = 0; i < numGames; i ++) {
+        chessboard board = failed[i] ? new_board(START_FEN) : boards[i];
+        packedPosition start;
+        pack_position(&board, &start);
+        unsigned short moves[256];
+        int length = next_pack_random(&seed) % 200;
+        int numMoves = 0;
+        for (; numMoves < length; numMoves ++) {
+            int count;
+            unsigned short* legal = list_to_arr(get_all_moves(&board), &count);
+            if (!count) {
+                free(legal);
+                break;
+            }
+            moves[numMoves] = legal[next_pack_random(&seed) % count];
+            free(legal);
+            make_move(&board, moves[numMoves]);
+        }
+        board_to_fen(&board, finalFens[i]);
+        free_board_states(&board);
+        write_game(writer, &start, moves, numMoves, i % 4);
+        totalMoves += numMoves;
+    }
+    close_game_writer(writer);
+
+    int gameMismatches = 0;
+    gameReader* reader = open_game_reader(gamesPath);
+    if (!reader) {
+        return 1;
+    }
+    gameRecord record;
+    int count = 0;
+    while (!next_game(reader, &record)) {
+        if (count >= numGames || record.result != (gameResult) (count % 4) || check_game(&record, finalFens[count])) {
+            gameMismatches ++;
+        }
+        count ++;
+    }
+    for (int i = 0; i < numGames; i ++) {
+        int number = next_pack_random(&seed) % numGames;
+        if (read_game(reader, number, &record) || check_game(&record, finalFens[number])) {
+            gameMismatches ++;
+        }
+    }
+    printf("%d games, %llu moves, %llu bytes, %d read in order, %d mismatches\n", numGames, (unsigned long long) totalMoves, (unsigned long long) reader->size, count, gameMismatches + (count != numGames));
+    close_game_reader(reader);
+
+    free(finalFens);
+    free(failed);
+    free(packed);
+    free(boards);
+    return errors || mismatches || gameMismatches || count != numGames;
+}
@@ -0,0 +1,95 @@
+#ifndef PACK
+#define PACK
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "chess.h"
+#include "compact.h"
+#include "pgn.h"
+
+#define GAMES_MAGIC 0x4d414743 // "CGAM"
+#define GAMES_VERSION 1
+#define GAMES_HEADER_SIZE 16
+#define GAME_RECORD_SIZE 36 // packed start position, move count, result and a reserved byte
+
+typedef struct packedPosition packedPosition;
+
+// 32 byte position: occupied squares with the piece on each in a nibble, from a1 to h8
+struct packedPosition {
+    uint64_t occupied;
+    uint8_t pieces[16]; // piece index of the n-th occupied square in nibble n, low nibble first
+    uint8_t flags; // black to move, then castling rights K, Q, k, q
+    uint8_t epSquare; // square of the pawn that can be captured en passant, 0xFF if none
+    uint16_t halfMoveClock;
+    uint16_t fullMoves;
+    uint8_t reserved[2];
+};
+
+// pack board; returns 1 if it has more than 32 pieces or a clock above 65535
+int pack_position(chessboard* board, packedPosition* packed);
+
+// pack compact position; returns 1 if it has more than 32 pieces or a clock above 65535
+int pack_compact_position(compactPosition* position, packedPosition* packed);
+
+// unpack and validate position into a board with an empty state stack
+fenError unpack_position(packedPosition* packed, chessboard* board);
+
+typedef struct gameWriter gameWriter;
+
+// game stream: header, then for each game a record followed by its 16-bit moves,
+// then the file offset of each game and a footer locating them; all fields are little-endian
+struct gameWriter {
+    FILE* file;
+    uint64_t offset;
+    uint64_t* index;
+    uint64_t numGames;
+    uint64_t capacity;
+    pthread_mutex_t lock; // games may be written from several threads
+};
+
+typedef struct gameRecord gameRecord;
+
+struct gameRecord {
+    packedPosition start;
+    gameResult result;
+    int numMoves;
+    const uint8_t* moves; // little-endian 16-bit moves in the mapped file, read with get_record_move
+};
+
+typedef struct gameReader gameReader;
+
+struct gameReader {
+    void* mapping;
+    size_t size;
+    uint64_t* index; // offset of each game
+    uint64_t numGames;
+    uint64_t next; // number of next game read by next_game
+};
+
+gameWriter* open_game_writer(char* path);
+
+void write_game(gameWriter* writer, packedPosition* start, unsigned short* moves, int numMoves, gameResult result);
+
+// write the index and close the file
+void close_game_writer(gameWriter* writer);
+
+// memory-map game stream; the index is rebuilt by scanning if the writer was not closed
+gameReader* open_game_reader(char* path);
+
+// read game by its number; returns 0 on success
+int read_game(gameReader* reader, uint64_t number, gameRecord* record);
+
+// read the game after the previous one; returns 0 on success, 1 at the end
+int next_game(gameReader* reader, gameRecord* record);
+
+// get move number i of record
+unsigned short get_record_move(gameRecord* record, int i);
+
+void close_game_reader(gameReader* reader);
+
+// check position packing against fen and game stream round trips; prints throughput
+int pack_check(char* fenPath, char* gamesPath);
+
+#endif
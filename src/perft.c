@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chess.h"
+#include "search.h"
+#include "perft.h"
+
+typedef struct perftBatch perftBatch;
+
+struct perftBatch {
+    char* data; // memory-mapped file
+    size_t size;
+    char** lines; // start of each position
+    int numLines;
+    int maxDepth;
+    int next; // index of next line to search, taken atomically
+    pthread_mutex_t lock; // serializes output
+    uint64_t nodes;
+    int mismatches;
+    int errors;
+};
+
+// get end of line starting at line
+char* line_end(perftBatch* batch, char* line) {
+    char* end = (char*) memchr(line, '\n', batch->data + batch->size - line);
+    return end ? end : batch->data + batch->size;
+}
+
+void perft_line(perftBatch* batch, int index, uint64_t* nodes, int* mismatches, int* errors) {
+    char* line = batch->lines[index];
+    char* end = line_end(batch, line);
+    char buffer[512];
+    if (end == batch->data + batch->size) {
+        // the last line may not be terminated inside the mapping, so copy it
+        size_t length = (size_t) (end - line) < sizeof(buffer) - 1 ? (size_t) (end - line) : sizeof(buffer) - 1;
+        memcpy(buffer, line, length);
+        buffer[length] = '\0';
+        line = buffer;
+        end = buffer + length;
+    }
+
+    chessboard board;
+    char* ops;
+    fenError error = parse_fen(line, &board, &ops);
+    if (error) {
+        pthread_mutex_lock(&batch->lock);
+        printf("position %d: %s\n", index + 1, fen_error_string(error));
+        pthread_mutex_unlock(&batch->lock);
+        (*errors) ++;
+        return;
+    }
+
+    // operations ";D<depth> <nodes>"
+    for (char* c = ops; c < end; c ++) {
+        if (*c != ';') {
+            continue;
+        }
+        c ++;
+        while (*c == ' ') {
+            c ++;
+        }
+        if (*c != 'D') {
+            continue;
+        }
+        char* number;
+        int depth = strtol(c + 1, &number, 10);
+        uint64_t expected = strtoull(number, &c, 10);
+        c --;
+        if (depth < 1 || depth > batch->maxDepth) {
+            continue;
+        }
+        uint64_t count = perft(&board, depth);
+        *nodes += count;
+        if (count != expected) {
+            pthread_mutex_lock(&batch->lock);
+            printf("position %d depth %d: expected %llu, got %llu: %.*s\n", index + 1, depth, (unsigned long long) expected, (unsigned long long) count, (int) (ops - line), line);
+            pthread_mutex_unlock(&batch->lock);
+            (*mismatches) ++;
+        }
+    }
+    free_board_states(&board);
+}
+
+void* perft_thread(void* arg) {
+    perftBatch* batch = (perftBatch*) arg;
+    uint64_t nodes = 0;
+    int mismatches = 0;
+    int errors = 0;
+    int index;
+    while ((index = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->numLines) {
+        perft_line(batch, index, &nodes, &mismatches, &errors);
+    }
+    __atomic_fetch_add(&batch->nodes, nodes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&batch->mismatches, mismatches, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&batch->errors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// run perft on every position of a memory-mapped epd file annotated with ";D<depth> <nodes>",
+// up to maxDepth, on numThreads threads; prints mismatches and aggregate nodes per second
+// returns the number of mismatched or invalid positions
+int perft_epd(char* path, int maxDepth, int numThreads) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    perftBatch batch;
+    batch.size = info.st_size;
+    batch.data = batch.size ? (char*) mmap(NULL, batch.size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (batch.data == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return 1;
+    }
+    madvise(batch.data, batch.size, MADV_SEQUENTIAL);
+
+    // index positions, skipping empty lines and comments
+    int capacity = 1024;
+    batch.lines = (char**) malloc(sizeof(char*) * capacity);
+    batch.numLines = 0;
+    for (char* line = batch.data; line < batch.data + batch.size; line = line_end(&batch, line) + 1) {
+        if (*line == '\n' || *line == '\r' || *line == '#') {
+            continue;
+        }
+        if (batch.numLines == capacity) {
+            capacity *= 2;
+            batch.lines = (char**) realloc(batch.lines, sizeof(char*) * capacity);
+        }
+        batch.lines[batch.numLines ++] = line;
+    }
+
+    batch.maxDepth = maxDepth;
+    batch.next = 0;
+    batch.nodes = 0;
+    batch.mismatches = 0;
+    batch.errors = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+
+    long startTime = get_time_ms();
+    pthread_t* threads = (pthread_t*) malloc(sizeof(pthread_t) * numThreads);
+    for (int i = 0; i < numThreads; i ++) {
+        pthread_create(&threads[i], NULL, perft_thread, &batch);
+    }
+    for (int i = 0; i < numThreads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    long elapsed = get_time_ms() - startTime;
+
+    printf("%d positions, %d invalid, %d mismatches\n", batch.numLines, batch.errors, batch.mismatches);
+    printf("nodes %llu time %ld ms nps %llu threads %d\n", (unsigned long long) batch.nodes, elapsed, (unsigned long long) (batch.nodes * 1000 / (elapsed + 1)), numThreads);
+
+    pthread_mutex_destroy(&batch.lock);
+    free(threads);
+    free(batch.lines);
+    if (batch.data) {
+        munmap(batch.data, batch.size);
+    }
+    return batch.errors + batch.mismatches;
+}
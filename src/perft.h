@@ -0,0 +1,11 @@
+#ifndef PERFT
+#define PERFT
+
+#define MAX_PERFT_DEPTH 16
+
+// run perft on every position of a memory-mapped epd file annotated with ";D<depth> <nodes>",
+// up to maxDepth, on numThreads threads; prints mismatches and aggregate nodes per second
+// returns the number of mismatched or invalid positions
+int perft_epd(char* path, int maxDepth, int numThreads);
+
+#endif
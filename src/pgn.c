@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chess.h"
+#include "search.h"
+#include "pgn.h"
+
+// piece type letters indexed by piece / 2
+const char* sanPieces = " NBRQK";
+
+// get piece type of san letter, 0 if it is not a piece
+int san_piece_type(char c) {
+    switch (c) {
+        case 'N':
+            return 1;
+        case 'B':
+            return 2;
+        case 'R':
+            return 3;
+        case 'Q':
+            return 4;
+        case 'K':
+            return 5;
+    }
+    return 0;
+}
+
+// get legal move written in standard algebraic notation, or 0 if there is none or it is ambiguous
+unsigned short san_to_move(chessboard* board, char* san, int length) {
+    // drop check, mate and annotation suffixes
+    while (length > 0 && (san[length - 1] == '+' || san[length - 1] == '#' || san[length - 1] == '!' || san[length - 1] == '?')) {
+        length --;
+    }
+    if (length < 2) {
+        return 0;
+    }
+
+    int castle = 0;
+    int type = 0;
+    int promotion = -1; // flag & 3 of the promotion
+    int fromFile = -1;
+    int fromRank = -1;
+    int target = -1;
+    if (san[0] == 'O' || san[0] == '0') {
+        if ((length == 3 && (strncmp(san, "O-O", 3) == 0 || strncmp(san, "0-0", 3) == 0))) {
+            castle = 2;
+        } else if (length == 5 && (strncmp(san, "O-O-O", 5) == 0 || strncmp(san, "0-0-0", 5) == 0)) {
+            castle = 3;
+        } else {
+            return 0;
+        }
+    } else {
+        int start = 0;
+        type = san_piece_type(san[0]);
+        if (type) {
+            start = 1;
+        }
+        int last = length - 1;
+        if (san_piece_type(san[last]) > 0 && san_piece_type(san[last]) < 5) {
+            promotion = san_piece_type(san[last]) - 1;
+            last --;
+            if (san[last] == '=') {
+                last --;
+            }
+        }
+        if (last - start < 1 || san[last - 1] < 'a' || san[last - 1] > 'h' || san[last] < '1' || san[last] > '8') {
+            return 0;
+        }
+        target = (san[last - 1] - 'a') + (san[last] - '1') * 8;
+        for (int i = start; i < last - 1; i ++) {
+            if (san[i] >= 'a' && san[i] <= 'h') {
+                fromFile = san[i] - 'a';
+            } else if (san[i] >= '1' && san[i] <= '8') {
+                fromRank = san[i] - '1';
+            } else if (san[i] != 'x' && san[i] != '-') {
+                return 0;
+            }
+        }
+    }
+
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+    unsigned short found = 0;
+    int matches = 0;
+    for (int i = 0; i < numMoves; i ++) {
+        unsigned short move = moves[i];
+        int flag = move >> 12;
+        if (castle) {
+            if (flag == castle) {
+                found = move;
+                matches ++;
+            }
+            continue;
+        }
+        int start = move & 0x3F;
+        if (((move >> 6) & 0x3F) != target || get_board_piece(board, start) / 2 != type ||
+            (fromFile >= 0 && (start & 7) != fromFile) || (fromRank >= 0 && (start >> 3) != fromRank)) {
+            continue;
+        }
+        if (promotion >= 0 ? !(flag & 8) || (flag & 3) != promotion : (flag & 8) != 0) {
+            continue;
+        }
+        found = move;
+        matches ++;
+    }
+    free(moves);
+    return matches == 1 ? found : 0;
+}
+
+// write move in standard algebraic notation including check and mate suffixes
+void move_to_san(chessboard* board, unsigned short move, char* str) {
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    int type = get_board_piece(board, start) / 2;
+    char* c = str;
+
+    if (flag == 2) {
+        c += sprintf(c, "O-O");
+    } else if (flag == 3) {
+        c += sprintf(c, "O-O-O");
+    } else {
+        if (type == 0) {
+            if (flag & 4) {
+                *c ++ = 'a' + (start & 7);
+            }
+        } else {
+            *c ++ = sanPieces[type];
+            // disambiguate from other pieces of the same type reaching the square
+            int numMoves;
+            unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+            int ambiguous = 0;
+            int sameFile = 0;
+            int sameRank = 0;
+            for (int i = 0; i < numMoves; i ++) {
+                int other = moves[i] & 0x3F;
+                if (other != start && ((moves[i] >> 6) & 0x3F) == end && get_board_piece(board, other) / 2 == type) {
+                    ambiguous = 1;
+                    sameFile |= (other & 7) == (start & 7);
+                    sameRank |= (other >> 3) == (start >> 3);
+                }
+            }
+            free(moves);
+            if (ambiguous) {
+                if (!sameFile) {
+                    *c ++ = 'a' + (start & 7);
+                } else if (!sameRank) {
+                    *c ++ = '1' + (start >> 3);
+                } else {
+                    *c ++ = 'a' + (start & 7);
+                    *c ++ = '1' + (start >> 3);
+                }
+            }
+        }
+        if (flag & 4) {
+            *c ++ = 'x';
+        }
+        *c ++ = 'a' + (end & 7);
+        *c ++ = '1' + (end >> 3);
+        if (flag & 8) {
+            *c ++ = '=';
+            *c ++ = sanPieces[(flag & 3) + 1];
+        }
+    }
+
+    make_move(board, move);
+    if (in_check(board)) {
+        int numMoves;
+        free(list_to_arr(get_all_moves(board), &numMoves));
+        *c ++ = numMoves ? '+' : '#';
+    }
+    undo_move(board, move);
+    *c = '\0';
+}
+
+// get result from "1-0", "0-1", "1/2-1/2" or anything else
+gameResult parse_result(char* str) {
+    if (strncmp(str, "1-0", 3) == 0) {
+        return ResultWhiteWins;
+    } else if (strncmp(str, "0-1", 3) == 0) {
+        return ResultBlackWins;
+    } else if (strncmp(str, "1/2-1/2", 7) == 0) {
+        return ResultDraw;
+    }
+    return ResultUnknown;
+}
+
+char* result_to_string(gameResult result) {
+    switch (result) {
+        case ResultWhiteWins:
+            return "1-0";
+        case ResultBlackWins:
+            return "0-1";
+        case ResultDraw:
+            return "1/2-1/2";
+        default:
+            return "*";
+    }
+}
+
+typedef struct pgnGame pgnGame;
+
+// tag section and movetext of a game inside the mapping
+struct pgnGame {
+    char* start;
+    char* end;
+};
+
+typedef struct pgnReader pgnReader;
+
+struct pgnReader {
+    pgnGame* games;
+    int numGames;
+    int next; // index of next game to replay, taken atomically
+    pgnMoveCallback callback;
+    void* data;
+    pgnStats stats;
+};
+
+int is_token_end(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '{' || c == '(' || c == ')' || c == ';';
+}
+
+// skip past the character closing the comment or variation at p
+char* skip_group(char* p, char* end) {
+    int depth = 0;
+    for (; p < end; p ++) {
+        if (*p == '{') {
+            char* close = (char*) memchr(p, '}', end - p);
+            p = close ? close : end - 1;
+        } else if (*p == '(') {
+            depth ++;
+        } else if (*p == ')' && -- depth == 0) {
+            return p + 1;
+        } else if (*p == ';') {
+            char* close = (char*) memchr(p, '\n', end - p);
+            p = close ? close : end - 1;
+        }
+        if (depth == 0) {
+            return p + 1;
+        }
+    }
+    return end;
+}
+
+// replay one game; returns number of plies or -1 on error, which is counted and reported
+int replay_game(pgnReader* reader, pgnGame* game) {
+    chessboard board;
+    parse_fen(START_FEN, &board, NULL);
+    gameResult result = ResultUnknown;
+    char* p = game->start;
+    char* end = game->end;
+
+    // tag pairs
+    while (p < end && *p == '[') {
+        char* lineEnd = (char*) memchr(p, '\n', end - p);
+        lineEnd = lineEnd ? lineEnd : end;
+        char* value = (char*) memchr(p, '"', lineEnd - p);
+        if (value) {
+            value ++;
+            if (strncmp(p, "[Result ", 8) == 0) {
+                result = parse_result(value);
+            } else if (strncmp(p, "[FEN ", 5) == 0) {
+                char fen[MAX_FEN_LENGTH];
+                char* close = (char*) memchr(value, '"', lineEnd - value);
+                int length = close && close - value < MAX_FEN_LENGTH ? close - value : 0;
+                memcpy(fen, value, length);
+                fen[length] = '\0';
+                fenError error = parse_fen(fen, &board, NULL);
+                if (error) {
+                    if (__atomic_fetch_add(&reader->stats.errors, 1, __ATOMIC_RELAXED) < 10) {
+                        fprintf(stderr, "game %d: %s\n", (int) (game - reader->games) + 1, fen_error_string(error));
+                    }
+                    return -1;
+                }
+            }
+        }
+        p = lineEnd + 1;
+        while (p < end && (*p == ' ' || *p == '\r' || *p == '\t')) {
+            p ++;
+        }
+    }
+
+    // movetext
+    int plies = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ')') {
+            p ++;
+        } else if (c == '{' || c == '(' || c == ';') {
+            p = skip_group(p, end);
+        } else if (c == '$') {
+            for (p ++; p < end && *p >= '0' && *p <= '9'; p ++);
+        } else if (c == '%' || c == '[') {
+            char* lineEnd = (char*) memchr(p, '\n', end - p);
+            p = lineEnd ? lineEnd + 1 : end;
+        } else {
+            char* token = p;
+            while (p < end && !is_token_end(*p)) {
+                p ++;
+            }
+            // move number, possibly followed by a move without space ("12.e4", "12...e5")
+            if (*token >= '1' && *token <= '9') {
+                char* dot = token;
+                while (dot < p && *dot >= '0' && *dot <= '9') {
+                    dot ++;
+                }
+                if (dot < p && *dot == '.') {
+                    while (dot < p && *dot == '.') {
+                        dot ++;
+                    }
+                    token = dot;
+                }
+            }
+            if (token == p) {
+                continue;
+            }
+            if (*token == '*' || parse_result(token) != ResultUnknown) {
+                break;
+            }
+            unsigned short move = san_to_move(&board, token, p - token);
+            if (!move) {
+                if (__atomic_fetch_add(&reader->stats.errors, 1, __ATOMIC_RELAXED) < 10) {
+                    fprintf(stderr, "game %d: illegal move %.*s\n", (int) (game - reader->games) + 1, (int) (p - token), token);
+                }
+                free_board_states(&board);
+                return -1;
+            }
+            if (reader->callback) {
+                reader->callback(&board, move, plies, result, reader->data);
+            }
+            make_move(&board, move);
+            plies ++;
+        }
+    }
+    free_board_states(&board);
+    return plies;
+}
+
+void* pgn_thread(void* arg) {
+    pgnReader* reader = (pgnReader*) arg;
+    uint64_t plies = 0;
+    int index;
+    while ((index = __atomic_fetch_add(&reader->next, 1, __ATOMIC_RELAXED)) < reader->numGames) {
+        int gamePlies = replay_game(reader, &reader->games[index]);
+        if (gamePlies > 0) {
+            plies += gamePlies;
+        }
+    }
+    __atomic_fetch_add(&reader->stats.plies, plies, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// replay all games of a memory-mapped pgn file on numThreads threads, calling callback
+// (if not NULL) for each move; returns 0 if the file could be read
+int read_pgn(char* path, int numThreads, pgnMoveCallback callback, void* data, pgnStats* stats) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    size_t size = info.st_size;
+    char* mapping = size ? (char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return 1;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    char* end = mapping + size;
+
+    // split into games: a tag line after movetext starts the next game
+    pgnReader reader;
+    int capacity = 1024;
+    reader.games = (pgnGame*) malloc(sizeof(pgnGame) * capacity);
+    reader.numGames = 0;
+    int inMovetext = 0;
+    for (char* line = mapping; line < end; ) {
+        char* lineEnd = (char*) memchr(line, '\n', end - line);
+        lineEnd = lineEnd ? lineEnd + 1 : end;
+        int blank = *line == '\n' || *line == '\r';
+        if (!blank && (reader.numGames == 0 || (*line == '[' && inMovetext))) {
+            if (reader.numGames == capacity) {
+                capacity *= 2;
+                reader.games = (pgnGame*) realloc(reader.games, sizeof(pgnGame) * capacity);
+            }
+            if (reader.numGames) {
+                reader.games[reader.numGames - 1].end = line;
+            }
+            reader.games[reader.numGames ++].start = line;
+            inMovetext = 0;
+        }
+        if (!blank && *line != '[') {
+            inMovetext = 1;
+        }
+        line = lineEnd;
+    }
+    if (reader.numGames) {
+        reader.games[reader.numGames - 1].end = end;
+    }
+
+    reader.next = 0;
+    reader.callback = callback;
+    reader.data = data;
+    reader.stats.games = reader.numGames;
+    reader.stats.plies = 0;
+    reader.stats.errors = 0;
+    pthread_t* threads = (pthread_t*) malloc(sizeof(pthread_t) * numThreads);
+    for (int i = 0; i < numThreads; i ++) {
+        pthread_create(&threads[i], NULL, pgn_thread, &reader);
+    }
+    for (int i = 0; i < numThreads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    *stats = reader.stats;
+
+    free(threads);
+    free(reader.games);
+    if (mapping) {
+        munmap(mapping, size);
+    }
+    return 0;
+}
+
+// replay pgn file and print games and plies per second
+int pgn_bench(char* path, int numThreads) {
+    pgnStats stats;
+    long startTime = get_time_ms();
+    if (read_pgn(path, numThreads, NULL, NULL, &stats)) {
+        return 1;
+    }
+    long elapsed = get_time_ms() - startTime;
+    printf("%llu games, %llu plies, %llu errors, %ld ms, threads %d\n", (unsigned long long) stats.games, (unsigned long long) stats.plies, (unsigned long long) stats.errors, elapsed, numThreads);
+    printf("%.0f games/s, %.0f plies/s\n", stats.games * 1000.0 / (elapsed + 1), stats.plies * 1000.0 / (elapsed + 1));
+    return stats.errors != 0;
+}
@@ -0,0 +1,45 @@
+#ifndef PGN
+#define PGN
+
+#include <stdint.h>
+#include "chess.h"
+
+#define MAX_SAN_LENGTH 8
+
+typedef enum gameResult gameResult;
+
+enum gameResult {
+    ResultUnknown, ResultWhiteWins, ResultBlackWins, ResultDraw
+};
+
+// called for each move of a game before it is made, with its ply counted from the start of the game,
+// which may be a [FEN] position; may be called from several threads at once
+typedef void (*pgnMoveCallback)(chessboard* board, unsigned short move, int ply, gameResult result, void* data);
+
+typedef struct pgnStats pgnStats;
+
+struct pgnStats {
+    uint64_t games;
+    uint64_t plies;
+    uint64_t errors; // games with an illegal or unreadable move or start position
+};
+
+// get legal move written in standard algebraic notation, or 0 if there is none or it is ambiguous
+unsigned short san_to_move(chessboard* board, char* san, int length);
+
+// write move in standard algebraic notation including check and mate suffixes
+void move_to_san(chessboard* board, unsigned short move, char* str);
+
+// get result from "1-0", "0-1", "1/2-1/2" or anything else
+gameResult parse_result(char* str);
+
+char* result_to_string(gameResult result);
+
+// replay all games of a memory-mapped pgn file on numThreads threads, calling callback
+// (if not NULL) for each move; returns 0 if the file could be read
+int read_pgn(char* path, int numThreads, pgnMoveCallback callback, void* data, pgnStats* stats);
+
+// replay pgn file and print games and plies per second
+int pgn_bench(char* path, int numThreads);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "chess.h"
+#include "search.h"
+#include "quad.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+_Static_assert(sizeof(quadBoard) == 32, "quad boards are 32 bytes");
+
+void pieces_to_quad(uint64_t* pieces, quadBoard* quad) {
+    quad->planes[0] = pieces[WhitePawn] | pieces[WhiteKnight] | pieces[WhiteBishop] | pieces[WhiteRook] | pieces[WhiteQueen] | pieces[WhiteKing];
+    uint64_t types[6];
+    for (int type = 0; type < 6; type ++) {
+        types[type] = pieces[2 * type] | pieces[2 * type + 1];
+    }
+    quad->planes[1] = types[0] | types[2] | types[4]; // pawns, bishops and queens have bit 0 of type + 1
+    quad->planes[2] = types[1] | types[2] | types[5];
+    quad->planes[3] = types[3] | types[4] | types[5];
+}
+
+// extract with the portable code only
+void quad_to_pieces_scalar(quadBoard* quad, uint64_t* pieces) {
+    uint64_t white = quad->planes[0];
+    for (int type = 0; type < 6; type ++) {
+        int code = type + 1;
+        uint64_t bitboard = (code & 1 ? quad->planes[1] : ~quad->planes[1]) & (code & 2 ? quad->planes[2] : ~quad->planes[2]) &
+            (code & 4 ? quad->planes[3] : ~quad->planes[3]);
+        pieces[2 * type] = bitboard & ~white;
+        pieces[2 * type + 1] = bitboard & white;
+    }
+}
+
+#if defined(__AVX2__)
+// one lane per piece type, pawns to rooks and then queens and kings; each plane is inverted
+// in the lanes whose type + 1 has its bit clear
+void quad_to_pieces(quadBoard* quad, uint64_t* pieces) {
+    __m256i white = _mm256_set1_epi64x(quad->planes[0]);
+    __m256i plane1 = _mm256_set1_epi64x(quad->planes[1]);
+    __m256i plane2 = _mm256_set1_epi64x(quad->planes[2]);
+    __m256i plane3 = _mm256_set1_epi64x(quad->planes[3]);
+    __m256i invert1 = _mm256_setr_epi64x(0, -1, 0, -1);
+    __m256i low = _mm256_and_si256(_mm256_and_si256(_mm256_xor_si256(plane1, invert1), _mm256_xor_si256(plane2, _mm256_setr_epi64x(-1, 0, 0, -1))),
+        _mm256_xor_si256(plane3, _mm256_setr_epi64x(-1, -1, -1, 0)));
+    __m256i high = _mm256_and_si256(_mm256_and_si256(_mm256_xor_si256(plane1, invert1), _mm256_xor_si256(plane2, _mm256_setr_epi64x(-1, 0, 0, 0))), plane3);
+
+    // interleave black and white of each type
+    __m256i even = _mm256_unpacklo_epi64(_mm256_andnot_si256(white, low), _mm256_and_si256(white, low)); // pawns and bishops
+    __m256i odd = _mm256_unpackhi_epi64(_mm256_andnot_si256(white, low), _mm256_and_si256(white, low)); // knights and rooks
+    _mm256_storeu_si256((__m256i*) pieces, _mm256_permute2x128_si256(even, odd, 0x20));
+    _mm256_storeu_si256((__m256i*) (pieces + 4), _mm256_permute2x128_si256(even, odd, 0x31));
+    even = _mm256_unpacklo_epi64(_mm256_andnot_si256(white, high), _mm256_and_si256(white, high));
+    odd = _mm256_unpackhi_epi64(_mm256_andnot_si256(white, high), _mm256_and_si256(white, high));
+    _mm256_storeu_si256((__m256i*) (pieces + 8), _mm256_permute2x128_si256(even, odd, 0x20));
+}
+#else
+void quad_to_pieces(quadBoard* quad, uint64_t* pieces) {
+    quad_to_pieces_scalar(quad, pieces);
+}
+#endif
+
+// get piece on square, 13 if empty
+int get_quad_piece(quadBoard* quad, int square) {
+    int code = ((quad->planes[0] >> square) & 1) | ((quad->planes[1] >> square) & 1) << 1 | ((quad->planes[2] >> square) & 1) << 2 | ((quad->planes[3] >> square) & 1) << 3;
+    return code ? code - 2 : 13;
+}
+
+uint64_t get_quad_occupied(quadBoard* quad) {
+    return quad->planes[1] | quad->planes[2] | quad->planes[3];
+}
+
+// compare move generation from both layouts on the positions of an fen or epd file
+int quad_bench(char* path) {
+    chessboard* boards;
+    int numPositions = load_positions(path, &boards, MAX_BENCH_POSITIONS);
+    if (numPositions < 0) {
+        return 1;
+    }
+
+    quadBoard* quads = (quadBoard*) aligned_alloc(32, sizeof(quadBoard) * (numPositions + 1));
+    int mismatches = 0;
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t pieces[12];
+        uint64_t scalarPieces[12];
+        pieces_to_quad(boards[i].pieces, &quads[i]);
+        quad_to_pieces(&quads[i], pieces);
+        quad_to_pieces_scalar(&quads[i], scalarPieces);
+        int different = memcmp(pieces, boards[i].pieces, sizeof(pieces)) || memcmp(scalarPieces, boards[i].pieces, sizeof(pieces));
+        for (int square = 0; square < 64 && !different; square ++) {
+            different = get_quad_piece(&quads[i], square) != get_board_piece(&boards[i], square);
+        }
+        mismatches += different;
+    }
+
+    uint64_t counts[3] = {0, 0, 0};
+    long times[3];
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        counts[0] += count_moves(&boards[i]);
+    }
+    times[0] = get_time_ms() - startTime;
+
+    for (int layout = 1; layout < 3; layout ++) {
+        startTime = get_time_ms();
+        for (int i = 0; i < numPositions; i ++) {
+            chessboard* board = &boards[i];
+            uint64_t pieces[12];
+            if (layout == 1) {
+                quad_to_pieces_scalar(&quads[i], pieces);
+            } else {
+                quad_to_pieces(&quads[i], pieces);
+            }
+            counts[layout] += generate_targets(pieces, board->turn, board->castling, board->epSquare, NULL);
+        }
+        times[layout] = get_time_ms() - startTime;
+    }
+
+    // conversions alone
+    uint64_t checksum = 0;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        uint64_t pieces[12];
+        quad_to_pieces(&quads[i], pieces);
+        checksum += pieces[i % 12];
+    }
+    long extractTime = get_time_ms() - startTime;
+    startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        pieces_to_quad(boards[i].pieces, &quads[numPositions]);
+        checksum += quads[numPositions].planes[i & 3];
+    }
+    long packTime = get_time_ms() - startTime;
+
+    printf("%d positions, %d conversion mismatches, %llu moves\n", numPositions, mismatches, (unsigned long long) counts[0]);
+    char* names[3] = {"pieces[12]", "quad, scalar extraction", "quad, simd extraction"};
+    for (int layout = 0; layout < 3; layout ++) {
+        printf("count moves from %-24s %ld ms, %.2f million positions/s\n", names[layout], times[layout], numPositions / 1000.0 / (times[layout] + 1));
+    }
+    printf("extract pieces: %ld ms, build quads: %ld ms (%llx)\n", extractTime, packTime, (unsigned long long) checksum);
+    printf("%zu bytes of pieces per board, %zu per quad board\n", sizeof(boards[0].pieces), sizeof(quadBoard));
+    free(quads);
+    free(boards);
+    return mismatches != 0 || counts[1] != counts[0] || counts[2] != counts[0];
+}
@@ -0,0 +1,31 @@
+#ifndef QUAD
+#define QUAD
+
+#include <stdint.h>
+#include "chess.h"
+
+typedef struct quadBoard quadBoard;
+
+// pieces in four bitboards, 32 bytes: the nibble of bits on each square is piece + 2, or 0 if
+// the square is empty; planes[0] holds the white pieces and planes[1..3] the bits of piece type + 1
+struct quadBoard {
+    uint64_t planes[4];
+} __attribute__((aligned(32)));
+
+void pieces_to_quad(uint64_t* pieces, quadBoard* quad);
+
+// extract the twelve piece bitboards
+void quad_to_pieces(quadBoard* quad, uint64_t* pieces);
+
+// extract with the portable code only
+void quad_to_pieces_scalar(quadBoard* quad, uint64_t* pieces);
+
+// get piece on square, 13 if empty
+int get_quad_piece(quadBoard* quad, int square);
+
+uint64_t get_quad_occupied(quadBoard* quad);
+
+// compare move generation from both layouts on the positions of an fen or epd file
+int quad_bench(char* path);
+
+#endif
@@ -0,0 +1,675 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "bitscan.h"
+#include "search.h"
+#include "nnue.h"
+
+// margins of shallow depth pruning indexed by remaining depth
+int futilityMargins[4] = {0, 200, 350, 500};
+int razorMargins[3] = {0, 300, 500};
+
+// piece values for ordering captures by most valuable victim, least valuable attacker
+int orderValues[6] = {1, 3, 3, 5, 9, 20};
+
+// piece values for static exchange evaluation and delta pruning
+int seeValues[6] = {100, 320, 330, 500, 900, 20000};
+#define DELTA_MARGIN 200
+
+// get monotonic time in milliseconds
+long get_time_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// enable all selective search features
+void init_search_options(searchOptions* options) {
+    options->nullMove = 1;
+    options->lateMoveReductions = 1;
+    options->futility = 1;
+    options->razoring = 1;
+    options->checkExtensions = 1;
+    options->seePruning = 1;
+    options->deltaPruning = 1;
+}
+
+// allocate transposition table of at most megabytes
+transpositionTable* new_transposition_table(int megabytes) {
+    uint64_t numEntries = 1;
+    while (numEntries * 2 * sizeof(ttEntry) <= (uint64_t) megabytes << 20) {
+        numEntries *= 2;
+    }
+    transpositionTable* tt = (transpositionTable*) malloc(sizeof(transpositionTable));
+    tt->entries = (ttEntry*) aligned_alloc(64, sizeof(ttEntry) * numEntries);
+    tt->mask = numEntries - 1;
+    clear_transposition_table(tt);
+    return tt;
+}
+
+void free_transposition_table(transpositionTable* tt) {
+    free(tt->entries);
+    free(tt);
+}
+
+void clear_transposition_table(transpositionTable* tt) {
+    memset(tt->entries, 0, sizeof(ttEntry) * (tt->mask + 1));
+    tt->age = 0;
+}
+
+// mate scores are stored relative to the node instead of the root
+int score_to_tt(int score, int ply) {
+    if (score > MATE_SCORE - MAX_PLY) {
+        return score + ply;
+    } else if (score < -MATE_SCORE + MAX_PLY) {
+        return score - ply;
+    }
+    return score;
+}
+
+int score_from_tt(int score, int ply) {
+    if (score > MATE_SCORE - MAX_PLY) {
+        return score - ply;
+    } else if (score < -MATE_SCORE + MAX_PLY) {
+        return score + ply;
+    }
+    return score;
+}
+
+// look up position; returns 1 and fills the outputs if it is stored
+int probe_transposition_table(transpositionTable* tt, uint64_t key, unsigned short* move, int* score, int* depth, int* bound) {
+    ttEntry* entry = &tt->entries[key & tt->mask];
+    uint64_t data = entry->data;
+    if ((entry->key ^ data) != key) {
+        return 0;
+    }
+    *move = data & 0xFFFF;
+    *score = (short) (data >> 16);
+    *depth = (data >> 32) & 0xFF;
+    *bound = (data >> 40) & 0xFF;
+    return 1;
+}
+
+// store position, keeping deeper entries of the current search
+void store_transposition_table(transpositionTable* tt, uint64_t key, unsigned short move, int score, int depth, int bound) {
+    ttEntry* entry = &tt->entries[key & tt->mask];
+    uint64_t old = entry->data;
+    int oldAge = (old >> 48) & 0xFF;
+    int oldDepth = (old >> 32) & 0xFF;
+    if ((entry->key ^ old) == key) {
+        if (!move) {
+            move = old & 0xFFFF; // keep best move of previous search of this position
+        }
+    } else if (oldAge == tt->age && depth + 2 < oldDepth && bound != TT_EXACT) {
+        return;
+    }
+    uint64_t data = move | (uint64_t) (unsigned short) score << 16 | (uint64_t) depth << 32 | (uint64_t) bound << 40 | (uint64_t) tt->age << 48;
+    entry->key = key ^ data;
+    entry->data = data;
+}
+
+// get permille of entries written by the current search
+int get_hashfull(transpositionTable* tt) {
+    int count = 0;
+    for (uint64_t i = 0; i < 1000 && i <= tt->mask; i ++) {
+        ttEntry* entry = &tt->entries[i];
+        if (entry->data && (int) ((entry->data >> 48) & 0xFF) == tt->age) {
+            count ++;
+        }
+    }
+    return count;
+}
+
+// reset search state; options, limits, signals and tables are kept
+void clear_search(searchInfo* info) {
+    info->stopped = 0;
+    info->nodes = 0;
+    info->bestMove = 0;
+    info->ponderMove = 0;
+    info->score = 0;
+    info->depth = 0;
+    memset(info->killers, 0, sizeof(info->killers));
+    memset(info->history, 0, sizeof(info->history));
+    memset(info->pvLength, 0, sizeof(info->pvLength));
+}
+
+// set stopped flag if a limit is reached
+void check_limits(searchInfo* info) {
+    searchSignals* signals = info->signals;
+    if (signals->stop) {
+        info->stopped = 1;
+    } else if (info->limits.nodes && info->nodes >= info->limits.nodes) {
+        info->stopped = 1;
+    } else if (info->limits.moveTime && !signals->ponder && (info->nodes & 1023) == 0 && get_time_ms() - signals->startTime >= info->limits.moveTime) {
+        info->stopped = 1;
+    }
+}
+
+
+// check if side to move has pieces other than pawns and king
+int has_non_pawn_material(chessboard* board) {
+    int offset = board->turn == White ? 1 : 0;
+    return (board->pieces[BlackKnight + offset] | board->pieces[BlackBishop + offset] | board->pieces[BlackRook + offset] | board->pieces[BlackQueen + offset]) != 0;
+}
+
+int is_quiet(unsigned short move) {
+    return ((move >> 12) & 0xC) == 0; // not a capture or promotion
+}
+
+// score moves for ordering
+void score_moves(chessboard* board, searchInfo* info, unsigned short* moves, int* scores, int numMoves, int ply, unsigned short ttMove) {
+    for (int i = 0; i < numMoves; i ++) {
+        unsigned short move = moves[i];
+        int start = move & 0x3F;
+        int end = (move >> 6) & 0x3F;
+        int flag = move >> 12;
+        int piece = get_board_piece(board, start);
+        if (move == ttMove) {
+            scores[i] = 300000;
+        } else if (flag & 8) {
+            scores[i] = 200000 + (flag & 3); // promotion, queen first
+        } else if (flag & 4) {
+            int victim = flag == 5 ? BlackPawn : get_board_piece(board, end);
+            scores[i] = 100000 + orderValues[victim / 2] * 100 - orderValues[piece / 2];
+        } else if (move == info->killers[ply][0]) {
+            scores[i] = 90000;
+        } else if (move == info->killers[ply][1]) {
+            scores[i] = 80000;
+        } else {
+            scores[i] = info->history[piece][end];
+        }
+    }
+}
+
+// move highest scored remaining move to index
+void pick_move(unsigned short* moves, int* scores, int numMoves, int index) {
+    int best = index;
+    for (int i = index + 1; i < numMoves; i ++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    unsigned short move = moves[index];
+    moves[index] = moves[best];
+    moves[best] = move;
+    int score = scores[index];
+    scores[index] = scores[best];
+    scores[best] = score;
+}
+
+// static exchange evaluation: material won by the side to move from the captures on the
+// destination of move, each side recapturing with its least valuable piece or standing pat
+int see(chessboard* board, unsigned short move) {
+    int start = move & 0x3F;
+    int end = (move >> 6) & 0x3F;
+    int flag = move >> 12;
+    uint64_t occupied = 0;
+    for (int i = 0; i < 12; i ++) {
+        occupied |= board->pieces[i];
+    }
+
+    int gain[32];
+    int depth = 0;
+    gain[0] = flag == 5 ? seeValues[0] : flag & 4 ? seeValues[get_board_piece(board, end) / 2] : 0;
+    if (flag == 5) {
+        occupied ^= 1ULL << (end - 8 + 16 * board->turn); // captured pawn is behind the destination
+    }
+    int piece = get_board_piece(board, start);
+    uint64_t from = 1ULL << start;
+    pieceColor side = board->turn;
+    while (from) {
+        depth ++;
+        gain[depth] = seeValues[piece / 2] - gain[depth - 1]; // value if the piece is recaptured
+        if ((-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]) < 0) {
+            break; // neither side gains by continuing
+        }
+        occupied ^= from; // sliders behind the piece now attack through it
+        side = 1 - side;
+        uint64_t attackers = get_square_attackers(board->pieces, occupied, end, side) & occupied;
+        int offset = side == White ? 1 : 0;
+        from = 0;
+        for (int type = BlackPawn; type <= BlackKing; type += 2) {
+            uint64_t pieces = attackers & board->pieces[type + offset];
+            if (pieces) {
+                from = pieces & -pieces;
+                piece = type + offset;
+                break;
+            }
+        }
+    }
+    while (-- depth) {
+        gain[depth - 1] = -(-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]);
+    }
+    return gain[0];
+}
+
+// search captures and promotions until the position is quiet
+int quiescence(chessboard* board, searchInfo* info, int ply, int alpha, int beta) {
+    info->nodes ++;
+    check_limits(info);
+    if (info->stopped) {
+        return 0;
+    }
+    if (ply >= MAX_PLY - 1) {
+        return evaluate(board, info->pawns); // before the per-ply arrays are touched
+    }
+    info->pvLength[ply] = ply;
+
+    int inCheck = in_check(board);
+    int bestScore = -INFINITE_SCORE;
+    int standPat = -INFINITE_SCORE;
+    if (!inCheck) {
+        bestScore = standPat = evaluate(board, info->pawns);
+        if (bestScore >= beta) {
+            return bestScore;
+        }
+        if (bestScore > alpha) {
+            alpha = bestScore;
+        }
+    }
+
+    // all evasions when in check, otherwise only captures and promotions
+    moveTargets targets;
+    get_move_targets(board, &targets);
+    if (!inCheck) {
+        int offset = board->turn == White ? 1 : 0;
+        uint64_t opponentPieces = 0;
+        for (int piece = 1 - offset; piece < 12; piece += 2) {
+            opponentPieces |= board->pieces[piece];
+        }
+        uint64_t pawnTargets = opponentPieces | 0xFF000000000000FFULL | (board->epSquare >= 0 ? 1ULL << board->epSquare : 0);
+        for (int square = 0; square < 64; square ++) {
+            targets.targets[square] &= (board->pieces[BlackPawn + offset] >> square) & 1 ? pawnTargets : opponentPieces;
+        }
+    }
+    unsigned short moves[256];
+    int numMoves = get_target_moves(board, &targets, moves);
+    if (numMoves == 0) {
+        return inCheck ? -MATE_SCORE + ply : bestScore;
+    }
+    int scores[numMoves];
+    score_moves(board, info, moves, scores, numMoves, ply, 0);
+
+    for (int i = 0; i < numMoves; i ++) {
+        pick_move(moves, scores, numMoves, i);
+        if (!inCheck && !((moves[i] >> 12) & 8)) {
+            // delta pruning: even winning the captured piece cannot lift the stand pat score to alpha
+            int captured = (moves[i] >> 12) == 5 ? BlackPawn : get_board_piece(board, (moves[i] >> 6) & 0x3F);
+            if (info->options.deltaPruning && standPat + seeValues[captured / 2] + DELTA_MARGIN <= alpha) {
+                continue;
+            }
+            // captures that lose material in the exchange
+            if (info->options.seePruning && see(board, moves[i]) < 0) {
+                continue;
+            }
+        }
+        make_move(board, moves[i]);
+        int score = -quiescence(board, info, ply + 1, -beta, -alpha);
+        undo_move(board, moves[i]);
+        if (info->stopped) {
+            break;
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                if (score >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return bestScore;
+}
+
+int alpha_beta(chessboard* board, searchInfo* info, int depth, int ply, int alpha, int beta, int allowNull) {
+    if (ply >= MAX_PLY - 1) {
+        return evaluate(board, info->pawns); // before the per-ply arrays are touched
+    }
+    int pvNode = beta - alpha > 1;
+    int inCheck = in_check(board);
+    info->pvLength[ply] = ply;
+
+    if (inCheck && info->options.checkExtensions) {
+        depth ++;
+    }
+    if (depth <= 0) {
+        return quiescence(board, info, ply, alpha, beta);
+    }
+
+    info->nodes ++;
+    check_limits(info);
+    if (info->stopped) {
+        return 0;
+    }
+    // a single repetition inside the tree is scored as a draw
+    if (ply > 0 && is_draw(board, 1)) {
+        return 0;
+    }
+    unsigned short ttMove = 0;
+    int ttScore, ttDepth, ttBound;
+    if (info->tt && probe_transposition_table(info->tt, board->key, &ttMove, &ttScore, &ttDepth, &ttBound)) {
+        ttScore = score_from_tt(ttScore, ply);
+        if (!pvNode && ttDepth >= depth && (ttBound == TT_EXACT || (ttBound == TT_LOWER && ttScore >= beta) || (ttBound == TT_UPPER && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+
+    int staticEval = inCheck ? -INFINITE_SCORE : evaluate(board, info->pawns);
+
+    if (!pvNode && !inCheck) {
+        // razoring: drop into quiescence when far below alpha
+        if (info->options.razoring && depth <= 2 && staticEval + razorMargins[depth] <= alpha) {
+            int score = quiescence(board, info, ply, alpha, beta);
+            if (score <= alpha) {
+                return score;
+            }
+        }
+
+        // reverse futility: static evaluation is far above beta
+        if (info->options.futility && depth <= 3 && staticEval - futilityMargins[depth] >= beta) {
+            return staticEval - futilityMargins[depth];
+        }
+
+        // null move: give the opponent a free move and see if we are still above beta
+        if (info->options.nullMove && allowNull && depth >= 3 && staticEval >= beta && has_non_pawn_material(board)) {
+            int reduction = 2 + depth / 6;
+            make_null_move(board);
+            int score = -alpha_beta(board, info, depth - 1 - reduction, ply + 1, -beta, -beta + 1, 0);
+            undo_null_move(board);
+            if (info->stopped) {
+                return 0;
+            }
+            if (score >= beta) {
+                return score >= MATE_SCORE - MAX_PLY ? beta : score; // do not trust mate scores
+            }
+        }
+    }
+
+    // futility: quiet moves cannot raise a score this far below alpha
+    int futile = info->options.futility && !pvNode && !inCheck && depth <= 2 && staticEval + futilityMargins[depth] <= alpha;
+
+    // the hash move is searched before generating, which most cutoffs then skip
+    checkInfo checks;
+    get_check_info(board, &checks);
+    int hashMoveLegal = ttMove && is_legal(board, &checks, ttMove);
+    int numMoves = 0;
+    unsigned short* moves = NULL;
+    int scores[256];
+
+    int originalAlpha = alpha;
+    int bestScore = -INFINITE_SCORE;
+    unsigned short bestMove = 0;
+    int movesSearched = 0;
+    for (int i = hashMoveLegal ? -1 : 0; ; i ++) {
+        unsigned short move = ttMove;
+        if (i >= 0) {
+            if (!moves) {
+                moves = list_to_arr(get_all_moves(board), &numMoves);
+                if (numMoves == 0) {
+                    free(moves);
+                    return inCheck ? -MATE_SCORE + ply : 0;
+                }
+                score_moves(board, info, moves, scores, numMoves, ply, ttMove);
+            }
+            if (i >= numMoves) {
+                break;
+            }
+            pick_move(moves, scores, numMoves, i);
+            move = moves[i];
+            if (hashMoveLegal && move == ttMove) {
+                continue;
+            }
+        }
+        int quiet = is_quiet(move);
+        int piece = get_board_piece(board, move & 0x3F);
+        int givesCheck = gives_check(board, &checks, move);
+
+        if (futile && quiet && !givesCheck && movesSearched > 0) {
+            continue;
+        }
+        make_move(board, move);
+
+        int score;
+        if (movesSearched == 0) {
+            score = -alpha_beta(board, info, depth - 1, ply + 1, -beta, -alpha, 1);
+        } else {
+            // late move reductions for quiet moves ordered after the good ones
+            int reduction = 0;
+            if (info->options.lateMoveReductions && depth >= 3 && movesSearched >= 3 && quiet && !inCheck && !givesCheck && move != info->killers[ply][0] && move != info->killers[ply][1]) {
+                reduction = movesSearched >= 8 ? 2 : 1;
+                if (reduction > depth - 2) {
+                    reduction = depth - 2;
+                }
+            }
+            score = -alpha_beta(board, info, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, 1);
+            if (score > alpha && reduction) {
+                score = -alpha_beta(board, info, depth - 1, ply + 1, -alpha - 1, -alpha, 1);
+            }
+            if (score > alpha && score < beta) {
+                score = -alpha_beta(board, info, depth - 1, ply + 1, -beta, -alpha, 1);
+            }
+        }
+        undo_move(board, move);
+        movesSearched ++;
+
+        if (info->stopped) {
+            break;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                // update principal variation
+                info->pv[ply][ply] = move;
+                for (int j = ply + 1; j < info->pvLength[ply + 1]; j ++) {
+                    info->pv[ply][j] = info->pv[ply + 1][j];
+                }
+                info->pvLength[ply] = info->pvLength[ply + 1];
+
+                if (score >= beta) {
+                    if (quiet) {
+                        if (info->killers[ply][0] != move) {
+                            info->killers[ply][1] = info->killers[ply][0];
+                            info->killers[ply][0] = move;
+                        }
+                        info->history[piece][(move >> 6) & 0x3F] += depth * depth;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    free(moves);
+    if (info->tt && !info->stopped) {
+        int bound = bestScore >= beta ? TT_LOWER : bestScore > originalAlpha ? TT_EXACT : TT_UPPER;
+        store_transposition_table(info->tt, board->key, bestMove, score_to_tt(bestScore, ply), depth, bound);
+    }
+    return bestScore;
+}
+
+// print uci info line for completed iteration
+void print_info(searchInfo* info, int depth, int score) {
+    long elapsed = get_time_ms() - info->signals->startTime;
+    uint64_t nodes = 0;
+    for (int i = 0; i < info->numThreads; i ++) {
+        nodes += info[i].nodes;
+    }
+    printf("info depth %d score ", depth);
+    if (score > MATE_SCORE - MAX_PLY) {
+        printf("mate %d", (MATE_SCORE - score + 1) / 2);
+    } else if (score < -MATE_SCORE + MAX_PLY) {
+        printf("mate %d", -(MATE_SCORE + score) / 2);
+    } else {
+        printf("cp %d", score);
+    }
+    printf(" nodes %llu time %ld nps %llu", (unsigned long long) nodes, elapsed, (unsigned long long) (nodes * 1000 / (elapsed + 1)));
+    if (info->tt) {
+        printf(" hashfull %d", get_hashfull(info->tt));
+    }
+    printf(" pv");
+    char str[6];
+    for (int i = 0; i < info->pvLength[0]; i ++) {
+        move_to_uci(info->pv[0][i], str);
+        printf(" %s", str);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// iterative deepening search; returns best move, or 0 if there are no legal moves
+unsigned short search(chessboard* board, searchInfo* info) {
+    clear_search(info);
+
+    int numMoves;
+    unsigned short* moves = list_to_arr(get_all_moves(board), &numMoves);
+    if (numMoves == 0) {
+        return 0;
+    }
+    info->bestMove = moves[0]; // fallback if the first iteration is interrupted
+    free(moves);
+
+    int maxDepth = info->limits.depth ? info->limits.depth : MAX_PLY - 1;
+    for (int depth = 1 + info->threadId % 2; depth <= maxDepth; depth ++) {
+        int score = alpha_beta(board, info, depth, 0, -INFINITE_SCORE, INFINITE_SCORE, 0);
+        if (info->stopped) {
+            // root moves searched to the end before the stop only replace the best move by beating it
+            if (info->pvLength[0] > 0) {
+                info->bestMove = info->pv[0][0];
+                info->ponderMove = info->pvLength[0] > 1 ? info->pv[0][1] : 0;
+            }
+            break;
+        }
+        info->bestMove = info->pv[0][0];
+        info->ponderMove = info->pvLength[0] > 1 ? info->pv[0][1] : 0;
+        info->score = score;
+        info->depth = depth;
+        if (info->verbose) {
+            print_info(info, depth, score);
+        }
+        long softTime = info->limits.softTime;
+        if (softTime && !info->signals->ponder && get_time_ms() - info->signals->startTime >= softTime) {
+            break;
+        }
+    }
+
+    return info->bestMove;
+}
+
+typedef struct searchThread searchThread;
+
+struct searchThread {
+    pthread_t thread;
+    chessboard board;
+    nnueAccumulator* accumulator;
+    searchInfo* info;
+};
+
+void* search_thread(void* arg) {
+    searchThread* thread = (searchThread*) arg;
+    search(&thread->board, thread->info);
+    return NULL;
+}
+
+// lazy smp: infos[0] searches board while the other threads search copies of it,
+// sharing the transposition table; returns best move of the main thread
+unsigned short search_threads(chessboard* board, searchInfo* infos, int numThreads) {
+    if (infos[0].tt) {
+        infos[0].tt->age = (infos[0].tt->age + 1) & 0xFF;
+    }
+    infos[0].numThreads = numThreads;
+    for (int i = 0; i < numThreads; i ++) {
+        infos[i].nodes = 0; // summed by the main thread before the helpers clear them
+    }
+    searchThread* threads = (searchThread*) malloc(sizeof(searchThread) * numThreads);
+    for (int i = 1; i < numThreads; i ++) {
+        searchThread* thread = &threads[i];
+        // the copy keeps the states of the game to see repetitions
+        copy_board(&thread->board, board);
+        thread->accumulator = NULL;
+        if (board->accumulator) {
+            thread->accumulator = (nnueAccumulator*) aligned_alloc(32, sizeof(nnueAccumulator));
+            nnue_attach(&thread->board, thread->accumulator, board->accumulator->network);
+        }
+        thread->info = &infos[i];
+        thread->info->threadId = i;
+        thread->info->numThreads = 1;
+        thread->info->verbose = 0;
+        pthread_create(&thread->thread, NULL, search_thread, thread);
+    }
+
+    infos[0].threadId = 0;
+    unsigned short move = search(board, &infos[0]);
+
+    infos[0].signals->stop = 1;
+    for (int i = 1; i < numThreads; i ++) {
+        pthread_join(threads[i].thread, NULL);
+        free_board_states(&threads[i].board);
+        free(threads[i].accumulator);
+    }
+    free(threads);
+    return move;
+}
+
+// bench positions shared by bench and copy_bench
+char* benchFens[NUM_BENCH_FENS] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 0 1",
+    "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 0 1",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+};
+
+// fixed depth search of bench positions, printing nodes and time
+int bench(int depth, searchOptions* options) {
+    int numPositions = NUM_BENCH_FENS;
+
+    searchInfo* info = (searchInfo*) malloc(sizeof(searchInfo));
+    info->options = *options;
+    info->limits.depth = depth;
+    info->limits.nodes = 0;
+    info->limits.moveTime = 0;
+    info->limits.softTime = 0;
+    searchSignals signals;
+    signals.stop = 0;
+    signals.ponder = 0;
+    info->signals = &signals;
+    info->verbose = 0;
+    info->threadId = 0;
+    info->numThreads = 1;
+    info->tt = new_transposition_table(16);
+    info->pawns = new_pawn_table(16384);
+
+    uint64_t totalNodes = 0;
+    long startTime = get_time_ms();
+    for (int i = 0; i < numPositions; i ++) {
+        chessboard board = new_board(benchFens[i]);
+        clear_transposition_table(info->tt);
+        signals.startTime = get_time_ms();
+        unsigned short move = search(&board, info);
+        char str[6];
+        move_to_uci(move, str);
+        printf("position %d: bestmove %s score %d nodes %llu\n", i + 1, str, info->score, (unsigned long long) info->nodes);
+        totalNodes += info->nodes;
+        free_board_states(&board);
+    }
+    long elapsed = get_time_ms() - startTime;
+
+    printf("\ndepth %d null %d lmr %d futility %d razoring %d extensions %d see %d delta %d\n", depth, options->nullMove, options->lateMoveReductions, options->futility, options->razoring, options->checkExtensions, options->seePruning, options->deltaPruning);
+    printf("nodes %llu time %ld ms nps %llu\n", (unsigned long long) totalNodes, elapsed, (unsigned long long) (totalNodes * 1000 / (elapsed + 1)));
+    print_pawn_table_stats(info->pawns);
+
+    free_transposition_table(info->tt);
+    free_pawn_table(info->pawns);
+    free(info);
+    return 0;
+}
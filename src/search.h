@@ -0,0 +1,122 @@
+#ifndef SEARCH
+#define SEARCH
+
+#include <stdint.h>
+#include "chess.h"
+#include "eval.h"
+
+#define MAX_PLY 64
+#define INFINITE_SCORE 32000
+#define MATE_SCORE 31000 // score of being mated at the root
+
+typedef struct searchOptions searchOptions;
+
+// selective search features, each can be turned off to measure its effect
+struct searchOptions {
+    int nullMove;
+    int lateMoveReductions;
+    int futility;
+    int razoring;
+    int checkExtensions;
+    int seePruning;
+    int deltaPruning;
+};
+
+typedef struct searchLimits searchLimits;
+
+// limits of a search; zero means no limit
+struct searchLimits {
+    int depth;
+    uint64_t nodes;
+    long moveTime; // milliseconds, search is aborted when it runs out
+    long softTime; // milliseconds, no new iteration is started after it
+};
+
+typedef struct searchSignals searchSignals;
+
+// shared by the searching threads and the thread reading input
+struct searchSignals {
+    volatile int stop;
+    volatile int ponder; // searching on the opponent's time, time limits do not apply
+    volatile long startTime; // reset on ponderhit
+};
+
+#define TT_EXACT 0
+#define TT_LOWER 1 // search failed high
+#define TT_UPPER 2 // search failed low
+
+typedef struct ttEntry ttEntry;
+
+// key is stored xored with data so entries torn by concurrent writes are not used
+struct ttEntry {
+    uint64_t key;
+    uint64_t data; // move | score << 16 | depth << 32 | bound << 40 | age << 48
+};
+
+typedef struct transpositionTable transpositionTable;
+
+// shared by all search threads
+struct transpositionTable {
+    ttEntry* entries;
+    uint64_t mask; // number of entries - 1
+    int age; // incremented for each search so old entries are replaced first
+};
+
+typedef struct searchInfo searchInfo;
+
+struct searchInfo {
+    searchOptions options;
+    searchLimits limits;
+    searchSignals* signals;
+    int stopped;
+    uint64_t nodes;
+    transpositionTable* tt; // may be NULL
+    pawnTable* pawns;
+    int verbose; // print uci info after each iteration
+    int threadId; // 0 for the main thread
+    int numThreads; // infos of all threads follow the main thread's info
+    unsigned short killers[MAX_PLY][2];
+    int history[12][64];
+    unsigned short pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    unsigned short bestMove;
+    unsigned short ponderMove; // expected reply to best move, 0 if unknown
+    int score;
+    int depth; // last completed depth
+};
+
+// get monotonic time in milliseconds
+long get_time_ms();
+
+// enable all selective search features
+void init_search_options(searchOptions* options);
+
+// reset search state; options, limits, signals and tables are kept
+void clear_search(searchInfo* info);
+
+// allocate transposition table of at most megabytes
+transpositionTable* new_transposition_table(int megabytes);
+
+void free_transposition_table(transpositionTable* tt);
+
+void clear_transposition_table(transpositionTable* tt);
+
+// get permille of entries written by the current search
+int get_hashfull(transpositionTable* tt);
+
+// iterative deepening search; returns best move, or 0 if there are no legal moves
+unsigned short search(chessboard* board, searchInfo* info);
+
+// lazy smp: infos[0] searches board while the other threads search copies of it,
+// sharing the transposition table; returns best move of the main thread
+unsigned short search_threads(chessboard* board, searchInfo* infos, int numThreads);
+
+#define NUM_BENCH_FENS 8
+
+// positions searched by bench and used by copy_bench
+extern char* benchFens[NUM_BENCH_FENS];
+
+// fixed depth search of bench positions, printing nodes and time
+int bench(int depth, searchOptions* options);
+
+#endif
@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "chess.h"
+#include "eval.h"
+#include "search.h"
+#include "pgn.h"
+#include "pack.h"
+#include "selfplay.h"
+
+// adjudication: a side is winning after this many plies at or above the score
+#define WIN_SCORE 1000
+#define WIN_PLIES 6
+// and the game is drawn after this many plies close to zero once it is long enough
+#define DRAW_SCORE 10
+#define DRAW_PLIES 10
+#define DRAW_MIN_PLY 80
+
+#define MAX_GAME_PLIES 1024
+#define PGN_BUFFER_SIZE 16384
+
+void init_selfplay_options(selfplayOptions* options) {
+    options->numGames = 100;
+    options->numThreads = 1;
+    options->nodes = 20000;
+    options->randomPlies = 8;
+    options->maxPlies = 400;
+    options->hash = 4;
+    options->seed = 1;
+    options->path = "selfplay.bin";
+}
+
+typedef struct selfplayRun selfplayRun;
+
+// shared by all worker threads
+struct selfplayRun {
+    selfplayOptions* options;
+    int next; // number of next game to play, taken atomically
+    gameWriter* writer; // binary output
+    FILE* pgn; // pgn output
+    pthread_mutex_t lock; // serializes pgn output
+    uint64_t plies;
+    int results[4]; // games of each gameResult
+};
+
+uint64_t next_selfplay_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// play one game; fills moves and returns result
+gameResult play_game(selfplayRun* run, searchInfo* info, int number, unsigned short* moves, int* numMoves, char* pgn) {
+    selfplayOptions* options = run->options;
+    uint64_t seed = options->seed * 0x9E3779B97F4A7C15ULL + number + 1;
+    chessboard board = new_board(START_FEN);
+    clear_transposition_table(info->tt);
+
+    gameResult result = ResultUnknown;
+    int winPlies[2] = {0, 0}; // consecutive plies each color was winning
+    int drawPlies = 0;
+    char* text = pgn;
+    int ply = 0;
+    for (; ply < options->maxPlies && ply < MAX_GAME_PLIES; ply ++) {
+        int count;
+        unsigned short* legal = list_to_arr(get_all_moves(&board), &count);
+        if (count == 0) {
+            free(legal);
+            if (in_check(&board)) {
+                result = board.turn == White ? ResultBlackWins : ResultWhiteWins;
+            } else {
+                result = ResultDraw;
+            }
+            break;
+        }
+        if (is_draw(&board, 2)) {
+            free(legal);
+            result = ResultDraw;
+            break;
+        }
+
+        unsigned short move;
+        if (ply < options->randomPlies) {
+            move = legal[next_selfplay_random(&seed) % count];
+        } else {
+            info->signals->startTime = get_time_ms();
+            move = search_threads(&board, info, 1);
+            info->signals->stop = 0;
+
+            // adjudicate on the score from white's point of view
+            int score = board.turn == White ? info->score : -info->score;
+            winPlies[White] = score >= WIN_SCORE ? winPlies[White] + 1 : 0;
+            winPlies[Black] = score <= -WIN_SCORE ? winPlies[Black] + 1 : 0;
+            drawPlies = ply >= DRAW_MIN_PLY && abs(score) <= DRAW_SCORE ? drawPlies + 1 : 0;
+        }
+        free(legal);
+
+        if (pgn) {
+            if (board.turn == White) {
+                text += sprintf(text, "%d. ", board.fullMoves);
+            }
+            move_to_san(&board, move, text);
+            text += strlen(text);
+            *text ++ = (ply % 16 == 15) ? '\n' : ' ';
+        }
+        moves[ply] = move;
+        make_move(&board, move);
+
+        if (winPlies[White] >= WIN_PLIES) {
+            result = ResultWhiteWins;
+            ply ++;
+            break;
+        } else if (winPlies[Black] >= WIN_PLIES) {
+            result = ResultBlackWins;
+            ply ++;
+            break;
+        } else if (drawPlies >= DRAW_PLIES) {
+            result = ResultDraw;
+            ply ++;
+            break;
+        }
+    }
+    if (result == ResultUnknown) {
+        result = ResultDraw; // game reached the maximum length
+    }
+    if (pgn) {
+        sprintf(text, "%s\n\n", result_to_string(result));
+    }
+    free_board_states(&board);
+    *numMoves = ply;
+    return result;
+}
+
+void* selfplay_thread(void* arg) {
+    selfplayRun* run = (selfplayRun*) arg;
+    selfplayOptions* options = run->options;
+
+    searchSignals signals;
+    signals.stop = 0;
+    signals.ponder = 0;
+    searchInfo* info = (searchInfo*) malloc(sizeof(searchInfo));
+    init_search_options(&info->options);
+    info->limits.depth = 0;
+    info->limits.nodes = options->nodes;
+    info->limits.moveTime = 0;
+    info->limits.softTime = 0;
+    info->signals = &signals;
+    info->verbose = 0;
+    info->tt = new_transposition_table(options->hash);
+    info->pawns = new_pawn_table(16384);
+
+    unsigned short* moves = (unsigned short*) malloc(sizeof(unsigned short) * MAX_GAME_PLIES);
+    char* movetext = run->pgn ? (char*) malloc(PGN_BUFFER_SIZE) : NULL;
+    packedPosition start;
+    chessboard startBoard;
+    parse_fen(START_FEN, &startBoard, NULL);
+    pack_position(&startBoard, &start);
+
+    int number;
+    while ((number = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) < options->numGames) {
+        int numMoves;
+        gameResult result = play_game(run, info, number, moves, &numMoves, movetext);
+        __atomic_fetch_add(&run->plies, numMoves, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&run->results[result], 1, __ATOMIC_RELAXED);
+
+        if (run->pgn) {
+            pthread_mutex_lock(&run->lock);
+            fprintf(run->pgn, "[Event \"selfplay\"]\n[Site \"?\"]\n[Round \"%d\"]\n[White \"Chess\"]\n[Black \"Chess\"]\n[Result \"%s\"]\n\n%s",
+                number + 1, result_to_string(result), movetext);
+            pthread_mutex_unlock(&run->lock);
+        } else {
+            write_game(run->writer, &start, moves, numMoves, result);
+        }
+    }
+
+    free(movetext);
+    free(moves);
+    free_transposition_table(info->tt);
+    free_pawn_table(info->pawns);
+    free(info);
+    return NULL;
+}
+
+// play games between two instances of the engine and write them to options->path
+int selfplay(selfplayOptions* options) {
+    selfplayRun run;
+    run.options = options;
+    run.next = 0;
+    run.plies = 0;
+    memset(run.results, 0, sizeof(run.results));
+    run.writer = NULL;
+    run.pgn = NULL;
+    int length = strlen(options->path);
+    if (length >= 4 && strcmp(options->path + length - 4, ".pgn") == 0) {
+        run.pgn = fopen(options->path, "w");
+        if (!run.pgn) {
+            fprintf(stderr, "cannot open %s\n", options->path);
+            return 1;
+        }
+    } else {
+        run.writer = open_game_writer(options->path);
+        if (!run.writer) {
+            return 1;
+        }
+    }
+    pthread_mutex_init(&run.lock, NULL);
+
+    long startTime = get_time_ms();
+    pthread_t* threads = (pthread_t*) malloc(sizeof(pthread_t) * options->numThreads);
+    for (int i = 0; i < options->numThreads; i ++) {
+        pthread_create(&threads[i], NULL, selfplay_thread, &run);
+    }
+    for (int i = 0; i < options->numThreads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    long elapsed = get_time_ms() - startTime;
+
+    if (run.pgn) {
+        fclose(run.pgn);
+    } else {
+        close_game_writer(run.writer);
+    }
+    pthread_mutex_destroy(&run.lock);
+    free(threads);
+
+    printf("%d games (+%d -%d =%d), %llu plies, %ld ms, threads %d\n", options->numGames, run.results[ResultWhiteWins], run.results[ResultBlackWins], run.results[ResultDraw],
+        (unsigned long long) run.plies, elapsed, options->numThreads);
+    printf("%.0f games/hour\n", options->numGames * 3600000.0 / (elapsed + 1));
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef SELFPLAY
+#define SELFPLAY
+
+#include <stdint.h>
+
+typedef struct selfplayOptions selfplayOptions;
+
+struct selfplayOptions {
+    int numGames;
+    int numThreads; // games played at the same time, one per thread
+    uint64_t nodes; // node limit of each search
+    int randomPlies; // random moves played from the starting position
+    int maxPlies; // games reaching this length are drawn
+    int hash; // transposition table megabytes per thread
+    uint64_t seed;
+    char* path; // output file, pgn if it ends with .pgn, otherwise the binary game format
+};
+
+void init_selfplay_options(selfplayOptions* options);
+
+// play games between two instances of the engine and write them to options->path
+int selfplay(selfplayOptions* options);
+
+#endif
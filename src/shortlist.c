@@ -65,6 +65,15 @@ int get_list_length(shortlist* l) {
     return i;
 }
 
+// free all items of list
+void free_list(shortlist* l) {
+    while (l) {
+        shortlist* next = l->next;
+        free(l);
+        l = next;
+    }
+}
+
 // free list and convert to array
 unsigned short* list_to_arr(shortlist* l, int* lenPtr) {
     if (!l) {
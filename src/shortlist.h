@@ -23,6 +23,9 @@ int get_list_length(shortlist* l);
 // append list to end of another list and update tail
 void append_list(shortlist* newList, shortlist** listPtr, shortlist** tailPtr);
 
+// free all items of list
+void free_list(shortlist* l);
+
 // free list and convert to array
 unsigned short* list_to_arr(shortlist* l, int* lenPtr);
 
@@ -0,0 +1,437 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include "chess.h"
+#include "eval.h"
+#include "nnue.h"
+#include "search.h"
+#include "book.h"
+#include "uci.h"
+
+#define MOVE_OVERHEAD 50 // milliseconds kept in reserve for communication
+
+typedef struct inputLine inputLine;
+
+struct inputLine {
+    char* text;
+    inputLine* next;
+};
+
+typedef struct uciEngine uciEngine;
+
+struct uciEngine {
+    chessboard board;
+    nnueNetwork* network; // NULL if none is loaded
+    nnueAccumulator* accumulator; // attached to board while a network is loaded
+    transpositionTable* tt;
+    searchInfo* infos; // one per thread
+    int numThreads;
+    openingBook* book; // NULL if none
+    uint64_t bookSeed;
+    searchSignals signals;
+
+    // lines queued by the input thread for the main thread
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    inputLine* head;
+    inputLine* tail;
+
+    // go commands counted under lock, so a stop or ponderhit applies to every go read before it
+    int goRead; // by the input thread
+    int goStarted; // searches started by the main thread
+    int goFinished; // best moves sent
+    int stopRead; // go commands read before the last stop or quit
+    int ponderhitRead; // go commands read before the last ponderhit
+};
+
+// write line to standard output; called from both threads
+void uci_send(char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    flockfile(stdout);
+    vprintf(format, args);
+    printf("\n");
+    fflush(stdout);
+    funlockfile(stdout);
+    va_end(args);
+}
+
+void push_line(uciEngine* engine, char* text) {
+    inputLine* line = (inputLine*) malloc(sizeof(inputLine));
+    line->text = text;
+    line->next = NULL;
+    pthread_mutex_lock(&engine->lock);
+    if (engine->tail) {
+        engine->tail->next = line;
+    } else {
+        engine->head = line;
+    }
+    engine->tail = line;
+    pthread_cond_signal(&engine->available);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// wait for next queued line; caller frees it
+char* pop_line(uciEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    while (!engine->head) {
+        pthread_cond_wait(&engine->available, &engine->lock);
+    }
+    inputLine* line = engine->head;
+    engine->head = line->next;
+    if (!engine->head) {
+        engine->tail = NULL;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    char* text = line->text;
+    free(line);
+    return text;
+}
+
+// stop the running search and every go read so far
+void stop_searches(uciEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    engine->stopRead = engine->goRead;
+    engine->signals.stop = 1;
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// check if a go has been read whose best move is not sent yet
+int is_searching(uciEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    int searching = engine->goFinished < engine->goRead;
+    pthread_mutex_unlock(&engine->lock);
+    return searching;
+}
+
+// read standard input, handling commands that must not wait for the search;
+// a go is queued like any other line, the main thread starts it after the previous search
+void* input_thread(void* arg) {
+    uciEngine* engine = (uciEngine*) arg;
+    char* text = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&text, &capacity, stdin)) >= 0) {
+        while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) {
+            text[-- length] = '\0';
+        }
+        if (strcmp(text, "stop") == 0) {
+            stop_searches(engine);
+        } else if (strcmp(text, "ponderhit") == 0) {
+            pthread_mutex_lock(&engine->lock);
+            engine->ponderhitRead = engine->goRead;
+            engine->signals.startTime = get_time_ms(); // our clock starts now
+            engine->signals.ponder = 0;
+            pthread_mutex_unlock(&engine->lock);
+        } else if (strcmp(text, "isready") == 0 && is_searching(engine)) {
+            uci_send("readyok");
+        } else {
+            if (strncmp(text, "go", 2) == 0 && (text[2] == ' ' || text[2] == '\0')) {
+                pthread_mutex_lock(&engine->lock);
+                engine->goRead ++;
+                pthread_mutex_unlock(&engine->lock);
+            }
+            if (strcmp(text, "quit") == 0) {
+                stop_searches(engine);
+            }
+            push_line(engine, strdup(text));
+            if (strcmp(text, "quit") == 0) {
+                break;
+            }
+        }
+    }
+    if (length < 0) {
+        stop_searches(engine);
+        push_line(engine, strdup("quit")); // end of input
+    }
+    free(text);
+    return NULL;
+}
+
+// allocate search state of each thread
+void set_threads(uciEngine* engine, int numThreads) {
+    for (int i = 0; i < engine->numThreads; i ++) {
+        free_pawn_table(engine->infos[i].pawns);
+    }
+    free(engine->infos);
+    engine->numThreads = numThreads;
+    engine->infos = (searchInfo*) malloc(sizeof(searchInfo) * numThreads);
+    for (int i = 0; i < numThreads; i ++) {
+        engine->infos[i].pawns = new_pawn_table(16384);
+    }
+}
+
+void set_position(uciEngine* engine, char* fen) {
+    free_board_states(&engine->board);
+    engine->board = new_board(fen);
+    if (engine->network) {
+        nnue_attach(&engine->board, engine->accumulator, engine->network);
+    }
+}
+
+void load_network(uciEngine* engine, char* path) {
+    nnue_attach(&engine->board, NULL, NULL);
+    nnue_unload(engine->network);
+    engine->network = NULL;
+    if (*path && strcmp(path, "<empty>") != 0 && !(engine->network = nnue_load(path))) {
+        uci_send("info string failed to load %s", path);
+    }
+    nnue_attach(&engine->board, engine->network ? engine->accumulator : NULL, engine->network);
+}
+
+// position [startpos | fen <fen>] [moves <move> ...]
+void parse_position(uciEngine* engine, char* args) {
+    char* fen = START_FEN;
+    char* moves = strstr(args, "moves");
+    if (moves && moves > args) {
+        moves[-1] = '\0';
+        moves += 5;
+    }
+    if (strncmp(args, "fen ", 4) == 0) {
+        fen = args + 4;
+        chessboard board;
+        fenError error = parse_fen(fen, &board, NULL);
+        if (error) {
+            uci_send("info string invalid fen: %s", fen_error_string(error));
+            return;
+        }
+    }
+    set_position(engine, fen);
+
+    char* save;
+    for (char* token = moves ? strtok_r(moves, " ", &save) : NULL; token; token = strtok_r(NULL, " ", &save)) {
+        unsigned short move = uci_to_move(&engine->board, token);
+        if (!move) {
+            uci_send("info string illegal move %s", token);
+            break;
+        }
+        make_move(&engine->board, move);
+    }
+}
+
+// count the best move of a go as sent
+void finish_go(uciEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    engine->goFinished ++;
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// go [depth n] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms] [binc ms] [movestogo n] [infinite] [ponder]
+void go(uciEngine* engine, char* args) {
+    searchLimits limits = {0, 0, 0, 0};
+    long time[2] = {0, 0};
+    long inc[2] = {0, 0};
+    int movesToGo = 0;
+    int infinite = 0;
+    int ponder = 0;
+
+    char* save;
+    for (char* token = strtok_r(args, " ", &save); token; token = strtok_r(NULL, " ", &save)) {
+        if (strcmp(token, "infinite") == 0) {
+            infinite = 1;
+        } else if (strcmp(token, "ponder") == 0) {
+            ponder = 1;
+        } else {
+            char* value = strtok_r(NULL, " ", &save);
+            if (!value) {
+                break;
+            }
+            if (strcmp(token, "depth") == 0) {
+                limits.depth = atoi(value);
+            } else if (strcmp(token, "nodes") == 0) {
+                limits.nodes = strtoull(value, NULL, 10);
+            } else if (strcmp(token, "movetime") == 0) {
+                limits.moveTime = atol(value);
+            } else if (strcmp(token, "wtime") == 0) {
+                time[White] = atol(value);
+            } else if (strcmp(token, "btime") == 0) {
+                time[Black] = atol(value);
+            } else if (strcmp(token, "winc") == 0) {
+                inc[White] = atol(value);
+            } else if (strcmp(token, "binc") == 0) {
+                inc[Black] = atol(value);
+            } else if (strcmp(token, "movestogo") == 0) {
+                movesToGo = atoi(value);
+            }
+        }
+    }
+
+    // budget a share of the remaining time, allowing up to three times as much to finish an iteration
+    long remaining = time[engine->board.turn];
+    if (remaining && !limits.moveTime && !infinite) {
+        long budget = remaining / (movesToGo ? movesToGo + 1 : 30) + inc[engine->board.turn] * 3 / 4;
+        long maximum = remaining - MOVE_OVERHEAD > 1 ? remaining - MOVE_OVERHEAD : 1;
+        limits.softTime = budget < maximum ? budget : maximum;
+        limits.moveTime = budget * 3 < maximum ? budget * 3 : maximum;
+    }
+
+    // a stop or ponderhit read while this go was queued still applies
+    pthread_mutex_lock(&engine->lock);
+    engine->goStarted ++;
+    engine->signals.stop = engine->stopRead >= engine->goStarted;
+    engine->signals.ponder = ponder && engine->ponderhitRead < engine->goStarted;
+    engine->signals.startTime = get_time_ms();
+    pthread_mutex_unlock(&engine->lock);
+
+    // book moves are played at once unless the search has to wait for stop or ponderhit
+    unsigned short bookMove = engine->book && !infinite && !ponder ? get_book_move(engine->book, &engine->board, &engine->bookSeed) : 0;
+    if (bookMove) {
+        char str[6];
+        move_to_uci(bookMove, str);
+        uci_send("info string book move");
+        uci_send("bestmove %s", str);
+        finish_go(engine);
+        return;
+    }
+
+    for (int i = 0; i < engine->numThreads; i ++) {
+        searchInfo* info = &engine->infos[i];
+        init_search_options(&info->options);
+        info->limits = limits;
+        info->signals = &engine->signals;
+        info->tt = engine->tt;
+        info->verbose = 1;
+    }
+    unsigned short move = search_threads(&engine->board, engine->infos, engine->numThreads);
+
+    // bestmove must not be sent before stop, or ponderhit when pondering
+    if (infinite || ponder) {
+        struct timespec pause = {0, 100000};
+        while (!engine->signals.stop && (infinite || engine->signals.ponder)) {
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    char best[6];
+    char ponderMove[6];
+    move_to_uci(move, best);
+    if (move && engine->infos[0].ponderMove) {
+        move_to_uci(engine->infos[0].ponderMove, ponderMove);
+        uci_send("bestmove %s ponder %s", best, ponderMove);
+    } else {
+        uci_send("bestmove %s", best);
+    }
+    finish_go(engine);
+}
+
+// setoption name <name> value <value>
+void set_option(uciEngine* engine, char* args) {
+    char* name = strstr(args, "name ");
+    char* value = strstr(args, " value ");
+    if (!name) {
+        return;
+    }
+    name += 5;
+    if (value) {
+        *value = '\0';
+        value += 7;
+    } else {
+        value = "";
+    }
+    if (strcasecmp(name, "Hash") == 0) {
+        int megabytes = atoi(value);
+        if (megabytes < 1) {
+            megabytes = 1;
+        } else if (megabytes > UCI_MAX_HASH) {
+            megabytes = UCI_MAX_HASH;
+        }
+        free_transposition_table(engine->tt);
+        engine->tt = new_transposition_table(megabytes);
+    } else if (strcasecmp(name, "Threads") == 0) {
+        int numThreads = atoi(value);
+        if (numThreads < 1) {
+            numThreads = 1;
+        } else if (numThreads > UCI_MAX_THREADS) {
+            numThreads = UCI_MAX_THREADS;
+        }
+        set_threads(engine, numThreads);
+    } else if (strcasecmp(name, "EvalFile") == 0) {
+        load_network(engine, value);
+    } else if (strcasecmp(name, "BookFile") == 0) {
+        close_book(engine->book);
+        engine->book = *value && strcmp(value, "<empty>") != 0 ? open_book(value) : NULL;
+        if (*value && strcmp(value, "<empty>") != 0 && !engine->book) {
+            uci_send("info string failed to load %s", value);
+        }
+    } else if (strcasecmp(name, "Ponder") != 0) {
+        uci_send("info string unknown option %s", name);
+    }
+}
+
+// read uci commands from standard input until quit
+int uci_loop() {
+    uciEngine* engine = (uciEngine*) calloc(1, sizeof(uciEngine));
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->available, NULL);
+    engine->accumulator = (nnueAccumulator*) aligned_alloc(32, sizeof(nnueAccumulator));
+    engine->tt = new_transposition_table(UCI_DEFAULT_HASH);
+    set_threads(engine, 1);
+    engine->bookSeed = get_time_ms() | 1;
+    set_position(engine, START_FEN);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, input_thread, engine);
+
+    while (1) {
+        char* line = pop_line(engine);
+        char* args = strchr(line, ' ');
+        if (args) {
+            *args = '\0';
+            args ++;
+        } else {
+            args = line + strlen(line);
+        }
+
+        if (strcmp(line, "quit") == 0) {
+            free(line);
+            break;
+        } else if (strcmp(line, "uci") == 0) {
+            uci_send("id name Chess");
+            uci_send("id author GitHubLearner19");
+            uci_send("option name Hash type spin default %d min 1 max %d", UCI_DEFAULT_HASH, UCI_MAX_HASH);
+            uci_send("option name Threads type spin default 1 min 1 max %d", UCI_MAX_THREADS);
+            uci_send("option name Ponder type check default false");
+            uci_send("option name EvalFile type string default <empty>");
+            uci_send("option name BookFile type string default <empty>");
+            uci_send("uciok");
+        } else if (strcmp(line, "isready") == 0) {
+            uci_send("readyok");
+        } else if (strcmp(line, "ucinewgame") == 0) {
+            clear_transposition_table(engine->tt);
+            set_position(engine, START_FEN);
+        } else if (strcmp(line, "position") == 0) {
+            parse_position(engine, args);
+        } else if (strcmp(line, "go") == 0) {
+            go(engine, args);
+        } else if (strcmp(line, "setoption") == 0) {
+            set_option(engine, args);
+        } else if (strcmp(line, "d") == 0) {
+            print_board(&engine->board);
+        } else if (*line) {
+            uci_send("info string unknown command %s", line);
+        }
+        free(line);
+    }
+
+    pthread_join(reader, NULL);
+    while (engine->head) {
+        free(pop_line(engine));
+    }
+    free_board_states(&engine->board);
+    for (int i = 0; i < engine->numThreads; i ++) {
+        free_pawn_table(engine->infos[i].pawns);
+    }
+    free(engine->infos);
+    free_transposition_table(engine->tt);
+    free(engine->accumulator);
+    nnue_unload(engine->network);
+    close_book(engine->book);
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->available);
+    free(engine);
+    return 0;
+}
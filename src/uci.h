@@ -0,0 +1,12 @@
+#ifndef UCI
+#define UCI
+
+#define UCI_DEFAULT_HASH 16 // megabytes
+#define UCI_MAX_HASH 4096
+#define UCI_MAX_THREADS 64
+
+// read uci commands from standard input until quit
+// input is read on its own thread so stop and ponderhit arrive during a search
+int uci_loop();
+
+#endif